@@ -1,8 +1,8 @@
 #include "BenchmarkLogger.hpp"
 
-// Define static members here (only once in the whole program)
-std::atomic<size_t> BenchmarkLogger::files_processed{0};
-std::atomic<size_t> BenchmarkLogger::files_successful{0};
-std::atomic<size_t> BenchmarkLogger::files_failed{0};
-std::atomic<size_t> BenchmarkLogger::total_bytes{0};
-std::atomic<int> BenchmarkLogger::crypto_operations_completed{0};
+// Define static members here (only once in the whole program).
+// Counters stay process-local until a BenchmarkLogger maps the shared page.
+BenchmarkLogger::Counters BenchmarkLogger::local_counters;
+BenchmarkLogger::Counters* BenchmarkLogger::counters = &BenchmarkLogger::local_counters;
+std::vector<std::pair<std::string, std::string>> BenchmarkLogger::run_details;
+std::vector<BenchmarkLogger::RootInfo> BenchmarkLogger::roots;
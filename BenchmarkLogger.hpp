@@ -2,36 +2,120 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include "src/app/FileHandling/BufferPool.hpp"
 #include <string>
+#include <utility>
+#include <vector>
 #include <atomic>
 #include <unistd.h>
 #include <filesystem>
+#include <fstream>
+#include <new>
+#include <algorithm>
+#include <sys/mman.h>
 
 class BenchmarkLogger {
+public:
+    // Input roots tracked separately in the report; later roots are not broken down
+    static const size_t MAX_ROOTS = 32;
+
 private:
     std::string operation_name;
     std::chrono::steady_clock::time_point start_time;
     pid_t main_process_id;
+    long cached_kb_at_start;
     
-    // Atomic counters (work across processes)
-    static std::atomic<size_t> files_processed;
-    static std::atomic<size_t> files_successful;
-    static std::atomic<size_t> files_failed;
-    static std::atomic<size_t> total_bytes;
-    static std::atomic<int> crypto_operations_completed;
+    // Per input root: filled in by workers as files complete
+    struct RootCounters {
+        std::atomic<size_t> files_completed{0};
+        std::atomic<size_t> bytes_completed{0};
+        std::atomic<long long> last_completion_ns{0};
+    };
+    struct RootInfo {
+        std::string path;
+        unsigned weight;
+        size_t files;
+    };
+
+    // Atomic counters, placed in a MAP_SHARED page by the constructor so
+    // forked workers update the same values the main process reports
+    struct Counters {
+        std::atomic<size_t> files_processed{0};
+        std::atomic<size_t> files_successful{0};
+        std::atomic<size_t> files_failed{0};
+        std::atomic<size_t> total_bytes{0};
+        std::atomic<size_t> bytes_completed{0};
+        std::atomic<size_t> logical_bytes{0};
+        std::atomic<size_t> physical_bytes{0};
+        std::atomic<size_t> compression_raw_bytes{0};
+        std::atomic<size_t> compression_stored_bytes{0};
+        std::atomic<size_t> compression_blocks{0};
+        std::atomic<size_t> compressed_blocks{0};
+        std::atomic<int> crypto_operations_completed{0};
+        RootCounters roots[MAX_ROOTS];
+    };
+    static Counters local_counters;
+    static Counters* counters;
+    static std::vector<std::pair<std::string, std::string>> run_details;
+    static std::vector<RootInfo> roots;
+
+    static void count_file_operation(const std::string& filepath, bool success) {
+        counters->files_processed.fetch_add(1);
+        
+        if (success) {
+            counters->files_successful.fetch_add(1);
+        } else {
+            counters->files_failed.fetch_add(1);
+            std::cout << "[PID:" << getpid() << "] FAILED: " << filepath << std::endl;
+        }
+        
+        // Progress every 50 files
+        size_t count = counters->files_processed.load();
+        if (count > 0 && count % 50 == 0) {
+            std::cout << "[PROGRESS] " << count << " files submitted for processing..." << std::endl;
+        }
+    }
+
+    static void count_root_completion(RootCounters& root, size_t bytes) {
+        root.files_completed.fetch_add(1);
+        root.bytes_completed.fetch_add(bytes);
+        long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        long long last = root.last_completion_ns.load();
+        while (last < now && !root.last_completion_ns.compare_exchange_weak(last, now)) {
+        }
+    }
+
+    // "Cached:" from /proc/meminfo in KB, -1 where unavailable. System-wide,
+    // so other activity on the machine shows up in the difference too.
+    static long read_page_cache_kb() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        long value;
+        std::string unit;
+        while (meminfo >> key >> value >> unit) {
+            if (key == "Cached:") {
+                return value;
+            }
+        }
+        return -1;
+    }
 
 public:
     BenchmarkLogger(const std::string& operation = "Multiprocess Crypto Operations") 
         : operation_name(operation), main_process_id(getpid()) {
         
+        cached_kb_at_start = read_page_cache_kb();
         start_time = std::chrono::steady_clock::now();
         
-        // Reset counters
-        files_processed.store(0);
-        files_successful.store(0);
-        files_failed.store(0);
-        total_bytes.store(0);
-        crypto_operations_completed.store(0);
+        // Reset counters (fresh shared page, falls back to process-local ones)
+        void* shared = mmap(nullptr, sizeof(Counters), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared != MAP_FAILED) {
+            counters = new (shared) Counters();
+        } else {
+            counters->~Counters();
+            new (counters) Counters();
+        }
         
         std::cout << "\n=== ENCRYPTDECRYPT BENCHMARK START ===" << std::endl;
         std::cout << "Operation: " << operation_name << std::endl;
@@ -49,38 +133,49 @@ public:
     }
 
     pid_t getMainPID() const { return main_process_id; }
+
+    // Bytes whose transform has finished, used as the throughput signal
+    static size_t completed_bytes() { return counters->bytes_completed.load(); }
     
     // Call this from your main.cpp when file operation starts
     static void record_file_operation(const std::string& filepath, bool success) {
-        files_processed.fetch_add(1);
-        
         if (success) {
-            files_successful.fetch_add(1);
-            
             try {
                 if (std::filesystem::exists(filepath)) {
                     size_t file_size = std::filesystem::file_size(filepath);
-                    total_bytes.fetch_add(file_size);
+                    counters->total_bytes.fetch_add(file_size);
                 }
             } catch (...) {
                 // Continue if file size unavailable
             }
-        } else {
-            files_failed.fetch_add(1);
-            std::cout << "[PID:" << getpid() << "] FAILED: " << filepath << std::endl;
         }
-        
-        // Progress every 50 files
-        size_t count = files_processed.load();
-        if (count > 0 && count % 50 == 0) {
-            std::cout << "[PROGRESS] " << count << " files submitted for processing..." << std::endl;
+        count_file_operation(filepath, success);
+    }
+
+    // Same, for inputs that are not files yet (archive members): size given by the caller
+    static void record_file_operation(const std::string& filepath, bool success, size_t file_size) {
+        if (success) {
+            counters->total_bytes.fetch_add(file_size);
         }
+        count_file_operation(filepath, success);
     }
 
-    // Call this from executeCryption() when crypto operation completes
-    static void record_crypto_completion(const std::string& filepath, bool encrypt_mode) {
-        int completed = crypto_operations_completed.fetch_add(1) + 1;
+    // Call this from executeCryption() when crypto operation completes;
+    // root is the index of the input root the file came from
+    static void record_crypto_completion(const std::string& filepath, bool encrypt_mode, size_t root = 0) {
+        int completed = counters->crypto_operations_completed.fetch_add(1) + 1;
         pid_t current_pid = getpid();
+
+        size_t file_size = 0;
+        try {
+            file_size = std::filesystem::file_size(filepath);
+            counters->bytes_completed.fetch_add(file_size);
+        } catch (...) {
+            // Continue if file size unavailable
+        }
+        if (root < MAX_ROOTS) {
+            count_root_completion(counters->roots[root], file_size);
+        }
         
         // Progress every 25 crypto operations
         if (completed % 25 == 0) {
@@ -89,6 +184,22 @@ public:
         }
     }
 
+    // Call this from executeCryption() with the file size and the bytes it
+    // actually read/wrote (they differ when holes in sparse files are skipped)
+    static void record_transfer(size_t logical, size_t physical) {
+        counters->logical_bytes.fetch_add(logical);
+        counters->physical_bytes.fetch_add(physical);
+    }
+
+    // Raw vs. framed bytes of a compressed file, and how many of its blocks
+    // were worth storing compressed
+    static void record_compression(size_t raw, size_t stored, size_t blocks, size_t compressed) {
+        counters->compression_raw_bytes.fetch_add(raw);
+        counters->compression_stored_bytes.fetch_add(stored);
+        counters->compression_blocks.fetch_add(blocks);
+        counters->compressed_blocks.fetch_add(compressed);
+    }
+
     // Time the entire crypto operation
     template<typename Func>
     static auto time_crypto_operation(const std::string& filepath, bool encrypt_mode, Func&& crypto_func) 
@@ -117,6 +228,16 @@ public:
         return result;
     }
 
+    // Register an input root of a multi-root run, in root index order
+    static void add_root(const std::string& path, unsigned weight, size_t files) {
+        roots.push_back(RootInfo{path, weight, files});
+    }
+
+    // Extra "key: value" lines for the report, e.g. submission order or I/O mode
+    static void set_run_detail(const std::string& key, const std::string& value) {
+        run_details.emplace_back(key, value);
+    }
+
     static void log(const std::string& message) {
         std::cout << "[PID:" << getpid() << "] " << message << std::endl;
     }
@@ -127,11 +248,11 @@ private:
         auto total_duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
         double duration_sec = total_duration_ns.count() / 1e9;
         
-        size_t total_files = files_processed.load();
-        size_t successful = files_successful.load();
-        size_t failed = files_failed.load();
-        size_t bytes = total_bytes.load();
-        int crypto_completed = crypto_operations_completed.load();
+        size_t total_files = counters->files_processed.load();
+        size_t successful = counters->files_successful.load();
+        size_t failed = counters->files_failed.load();
+        size_t bytes = counters->total_bytes.load();
+        int crypto_completed = counters->crypto_operations_completed.load();
         
         std::cout << "\n";
         std::cout << "================================" << std::endl;
@@ -140,6 +261,13 @@ private:
         std::cout << "Operation: " << operation_name << std::endl;
         std::cout << "Total Duration: " << std::fixed << std::setprecision(6) << duration_sec << " seconds" << std::endl;
         std::cout << "Duration (ns): " << total_duration_ns.count() << " nanoseconds" << std::endl;
+
+        if (!run_details.empty()) {
+            std::cout << "\nRUN CONFIGURATION:" << std::endl;
+            for (const auto& detail : run_details) {
+                std::cout << detail.first << ": " << detail.second << std::endl;
+            }
+        }
         
         std::cout << "\nFILE PROCESSING:" << std::endl;
         std::cout << "Files Submitted: " << total_files << std::endl;
@@ -152,6 +280,26 @@ private:
         
         std::cout << "\nDATA PROCESSING:" << std::endl;
         std::cout << "Total Data: " << std::fixed << std::setprecision(2) << (bytes / (1024.0 * 1024.0)) << " MB" << std::endl;
+        size_t logical = counters->logical_bytes.load();
+        size_t physical = counters->physical_bytes.load();
+        std::cout << "Logical Data: " << std::fixed << std::setprecision(2) << (logical / (1024.0 * 1024.0)) << " MB" << std::endl;
+        std::cout << "Physical Data (read/written): " << std::fixed << std::setprecision(2) << (physical / (1024.0 * 1024.0)) << " MB" << std::endl;
+        std::cout << "Holes Skipped: " << std::fixed << std::setprecision(2) << ((logical - std::min(logical, physical)) / (1024.0 * 1024.0)) << " MB" << std::endl;
+
+        size_t framed_blocks = counters->compression_blocks.load();
+        if (framed_blocks > 0) {
+            size_t raw = counters->compression_raw_bytes.load();
+            size_t stored = counters->compression_stored_bytes.load();
+            std::cout << "\nCOMPRESSION:" << std::endl;
+            std::cout << "Uncompressed Data: " << std::fixed << std::setprecision(2) << (raw / (1024.0 * 1024.0)) << " MB" << std::endl;
+            std::cout << "Stored Data (framed): " << std::fixed << std::setprecision(2) << (stored / (1024.0 * 1024.0)) << " MB" << std::endl;
+            std::cout << "Compression Ratio: " << std::fixed << std::setprecision(2) << (stored > 0 ? double(raw) / stored : 0.0) << ":1" << std::endl;
+            std::cout << "Blocks Stored Compressed: " << counters->compressed_blocks.load() << " of " << framed_blocks << std::endl;
+            if (duration_sec > 0) {
+                std::cout << "Stored MB/second: " << std::fixed << std::setprecision(2) << ((stored / (1024.0 * 1024.0)) / duration_sec) << std::endl;
+                std::cout << "Net MB/second (uncompressed): " << std::fixed << std::setprecision(2) << ((raw / (1024.0 * 1024.0)) / duration_sec) << std::endl;
+            }
+        }
         
         if (duration_sec > 0) {
             std::cout << "\nPERFORMANCE METRICS:" << std::endl;
@@ -159,7 +307,46 @@ private:
             std::cout << "Crypto ops/second: " << std::fixed << std::setprecision(2) << (crypto_completed / duration_sec) << std::endl;
             std::cout << "MB/second: " << std::fixed << std::setprecision(2) << ((bytes / (1024.0 * 1024.0)) / duration_sec) << std::endl;
         }
+
+        if (roots.size() > 1) {
+            long long start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time.time_since_epoch()).count();
+            std::cout << "\nINPUT ROOTS (weighted fair share):" << std::endl;
+            for (size_t i = 0; i < roots.size() && i < MAX_ROOTS; i++) {
+                const RootCounters& done = counters->roots[i];
+                double mb = done.bytes_completed.load() / (1024.0 * 1024.0);
+                long long last_ns = done.last_completion_ns.load();
+                std::cout << "[" << i << "] " << roots[i].path << " (weight " << roots[i].weight << "): "
+                          << done.files_completed.load() << "/" << roots[i].files << " files, "
+                          << std::fixed << std::setprecision(2) << mb << " MB";
+                if (last_ns > 0) {
+                    double finished_sec = (last_ns - start_ns) / 1e9;
+                    std::cout << ", finished at " << std::setprecision(3) << finished_sec << " s, "
+                              << std::setprecision(2) << (finished_sec > 0 ? mb / finished_sec : 0.0) << " MB/s";
+                }
+                std::cout << std::endl;
+            }
+        }
         
+        const BufferPool::Stats& pool = BufferPool::instance().stats();
+        std::cout << "\nBUFFER POOL:" << std::endl;
+        std::cout << "Block Size: " << BufferPool::instance().blockSize() / 1024 << " KB" << std::endl;
+        // Every forked worker handles one file and exits, so its thread
+        // cache never gets to serve a second block from another file
+        std::cout << "Pool Hit Rate: N/A (one file per forked worker)" << std::endl;
+        std::cout << "Peak Buffers In Flight: " << std::fixed << std::setprecision(2)
+                  << pool.peakBytesInFlight.load() / (1024.0 * 1024.0) << " MB of "
+                  << BufferPool::instance().budget() / (1024.0 * 1024.0) << " MB budget" << std::endl;
+        std::cout << "Backpressure Waits: " << pool.waits.load() << std::endl;
+
+        long cached_kb_at_end = read_page_cache_kb();
+        if (cached_kb_at_start >= 0 && cached_kb_at_end >= 0) {
+            std::cout << "\nPAGE CACHE:" << std::endl;
+            std::cout << "Cached Before: " << std::fixed << std::setprecision(2) << cached_kb_at_start / 1024.0 << " MB" << std::endl;
+            std::cout << "Cached After: " << std::fixed << std::setprecision(2) << cached_kb_at_end / 1024.0 << " MB" << std::endl;
+            std::cout << "Page Cache Change: " << std::showpos << std::fixed << std::setprecision(2)
+                      << (cached_kb_at_end - cached_kb_at_start) / 1024.0 << std::noshowpos << " MB" << std::endl;
+        }
+
         std::cout << "\nMULTIPROCESS INFO:" << std::endl;
         std::cout << "CPU Cores Available: " << sysconf(_SC_NPROCESSORS_ONLN) << std::endl;
         std::cout << "Main Process PID: " << main_process_id << std::endl;
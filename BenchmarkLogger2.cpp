@@ -5,5 +5,15 @@ std::atomic<size_t> BenchmarkLogger2::files_processed{0};
 std::atomic<size_t> BenchmarkLogger2::files_successful{0};
 std::atomic<size_t> BenchmarkLogger2::files_failed{0};
 std::atomic<size_t> BenchmarkLogger2::total_bytes{0};
+std::atomic<size_t> BenchmarkLogger2::bytes_completed{0};
 std::atomic<int> BenchmarkLogger2::crypto_operations_completed{0};
+std::atomic<size_t> BenchmarkLogger2::logical_bytes{0};
+std::atomic<size_t> BenchmarkLogger2::physical_bytes{0};
+std::atomic<size_t> BenchmarkLogger2::compression_raw_bytes{0};
+std::atomic<size_t> BenchmarkLogger2::compression_stored_bytes{0};
+std::atomic<size_t> BenchmarkLogger2::compression_blocks{0};
+std::atomic<size_t> BenchmarkLogger2::compressed_blocks{0};
+BenchmarkLogger2::RootCounters BenchmarkLogger2::root_counters[BenchmarkLogger2::MAX_ROOTS];
+std::vector<std::pair<std::string, std::string>> BenchmarkLogger2::run_details;
+std::vector<BenchmarkLogger2::RootInfo> BenchmarkLogger2::roots;
 std::mutex BenchmarkLogger2::output_mutex;
@@ -2,32 +2,92 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include "src/app/FileHandling/BufferPool.hpp"
 #include <string>
+#include <utility>
+#include <vector>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <filesystem>
 #include <fstream>
+#include <algorithm>
 
 class BenchmarkLogger2 {
+public:
+    // Input roots tracked separately in the report; later roots are not broken down
+    static const size_t MAX_ROOTS = 32;
+
 private:
     std::string operation_name;
     std::chrono::steady_clock::time_point start_time;
     std::thread::id main_thread_id;
+    long cached_kb_at_start;
+
+    // Per input root: filled in by workers as files complete
+    struct RootCounters {
+        std::atomic<size_t> files_completed{0};
+        std::atomic<size_t> bytes_completed{0};
+        std::atomic<long long> last_completion_ns{0};
+    };
+    struct RootInfo {
+        std::string path;
+        unsigned weight;
+        size_t files;
+    };
 
     // Atomic counters (shared across threads)
     static std::atomic<size_t> files_processed;
     static std::atomic<size_t> files_successful;
     static std::atomic<size_t> files_failed;
     static std::atomic<size_t> total_bytes;
+    static std::atomic<size_t> bytes_completed;
     static std::atomic<int> crypto_operations_completed;
+    static std::atomic<size_t> logical_bytes;
+    static std::atomic<size_t> physical_bytes;
+    static std::atomic<size_t> compression_raw_bytes;
+    static std::atomic<size_t> compression_stored_bytes;
+    static std::atomic<size_t> compression_blocks;
+    static std::atomic<size_t> compressed_blocks;
     
+    static RootCounters root_counters[MAX_ROOTS];
+
+    static std::vector<std::pair<std::string, std::string>> run_details;
+    static std::vector<RootInfo> roots;
+
     // Mutex for thread-safe output
     static std::mutex output_mutex;
 
+    static void count_root_completion(RootCounters& root, size_t bytes) {
+        root.files_completed.fetch_add(1);
+        root.bytes_completed.fetch_add(bytes);
+        long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        long long last = root.last_completion_ns.load();
+        while (last < now && !root.last_completion_ns.compare_exchange_weak(last, now)) {
+        }
+    }
+
+    // "Cached:" from /proc/meminfo in KB, -1 where unavailable. System-wide,
+    // so other activity on the machine shows up in the difference too.
+    static long read_page_cache_kb() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        long value;
+        std::string unit;
+        while (meminfo >> key >> value >> unit) {
+            if (key == "Cached:") {
+                return value;
+            }
+        }
+        return -1;
+    }
+
 public:
     BenchmarkLogger2(const std::string& operation = "Multithreaded Crypto Operations")
         : operation_name(operation), main_thread_id(std::this_thread::get_id()) {
         
+        cached_kb_at_start = read_page_cache_kb();
         start_time = std::chrono::steady_clock::now();
         
         // Reset counters
@@ -35,7 +95,14 @@ public:
         files_successful.store(0);
         files_failed.store(0);
         total_bytes.store(0);
+        bytes_completed.store(0);
         crypto_operations_completed.store(0);
+        logical_bytes.store(0);
+        physical_bytes.store(0);
+        compression_raw_bytes.store(0);
+        compression_stored_bytes.store(0);
+        compression_blocks.store(0);
+        compressed_blocks.store(0);
         
         std::lock_guard<std::mutex> lock(output_mutex);
         std::cout << "\n=== ENCRYPTDECRYPT BENCHMARK START (THREADS) ===" << std::endl;
@@ -55,6 +122,10 @@ public:
 
     std::thread::id getMainThreadID() const { return main_thread_id; }
 
+    // Bytes of finished files (counted at completion, whatever their size),
+    // used as the throughput signal
+    static size_t completed_bytes() { return bytes_completed.load(); }
+
     static void record_file_operation(const std::string& filepath, bool success) {
         files_processed.fetch_add(1);
 
@@ -74,10 +145,18 @@ public:
         }
     }
 
-    static void record_crypto_completion(const std::string& filepath, bool encrypt_mode) {
+    static void record_crypto_completion(const std::string& filepath, bool encrypt_mode, size_t root = 0) {
         int completed = crypto_operations_completed.fetch_add(1) + 1;
         std::thread::id tid = std::this_thread::get_id();
 
+        std::error_code ec;
+        uintmax_t completed_size = std::filesystem::file_size(filepath, ec);
+        size_t completed_bytes = ec ? 0 : static_cast<size_t>(completed_size);
+        bytes_completed.fetch_add(completed_bytes);
+        if (root < MAX_ROOTS) {
+            count_root_completion(root_counters[root], completed_bytes);
+        }
+
         // Try to get file size safely (file should be closed and complete now)
         try {
             std::ifstream file(filepath, std::ios::binary | std::ios::ate);
@@ -101,6 +180,21 @@ public:
         }
     }
 
+    // Logical file size vs. bytes actually read/written (holes are skipped)
+    static void record_transfer(size_t logical, size_t physical) {
+        logical_bytes.fetch_add(logical);
+        physical_bytes.fetch_add(physical);
+    }
+
+    // Raw vs. framed bytes of a compressed file, and how many of its blocks
+    // were worth storing compressed
+    static void record_compression(size_t raw, size_t stored, size_t blocks, size_t compressed) {
+        compression_raw_bytes.fetch_add(raw);
+        compression_stored_bytes.fetch_add(stored);
+        compression_blocks.fetch_add(blocks);
+        compressed_blocks.fetch_add(compressed);
+    }
+
     template<typename Func>
     static auto time_crypto_operation(const std::string& filepath, bool encrypt_mode, Func&& crypto_func)
         -> decltype(crypto_func()) {
@@ -123,6 +217,17 @@ public:
         return result;
     }
 
+    // Register an input root of a multi-root run, in root index order
+    static void add_root(const std::string& path, unsigned weight, size_t files) {
+        roots.push_back(RootInfo{path, weight, files});
+    }
+
+    // Extra "key: value" lines for the report, e.g. submission order or I/O mode
+    static void set_run_detail(const std::string& key, const std::string& value) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        run_details.emplace_back(key, value);
+    }
+
     static void log(const std::string& message) {
         std::lock_guard<std::mutex> lock(output_mutex);
         std::cout << "[TID:" << std::this_thread::get_id() << "] " << message << std::endl;
@@ -151,6 +256,13 @@ private:
         std::cout << "Total Duration: " << std::fixed << std::setprecision(6) << duration_sec << " seconds" << std::endl;
         std::cout << "Duration (ns): " << total_duration_ns.count() << " nanoseconds" << std::endl;
 
+        if (!run_details.empty()) {
+            std::cout << "\nRUN CONFIGURATION:" << std::endl;
+            for (const auto& detail : run_details) {
+                std::cout << detail.first << ": " << detail.second << std::endl;
+            }
+        }
+
         std::cout << "\nFILE PROCESSING:" << std::endl;
         std::cout << "Files Submitted: " << total_files << std::endl;
         std::cout << "Files Successful: " << successful << " (✓)" << std::endl;
@@ -171,6 +283,26 @@ private:
         } else {
             std::cout << "Total Data: N/A (file size tracking failed)" << std::endl;
         }
+        size_t logical = logical_bytes.load();
+        size_t physical = physical_bytes.load();
+        std::cout << "Logical Data: " << std::fixed << std::setprecision(2) << (logical / (1024.0 * 1024.0)) << " MB" << std::endl;
+        std::cout << "Physical Data (read/written): " << std::fixed << std::setprecision(2) << (physical / (1024.0 * 1024.0)) << " MB" << std::endl;
+        std::cout << "Holes Skipped: " << std::fixed << std::setprecision(2) << ((logical - std::min(logical, physical)) / (1024.0 * 1024.0)) << " MB" << std::endl;
+
+        size_t framed_blocks = compression_blocks.load();
+        if (framed_blocks > 0) {
+            size_t raw = compression_raw_bytes.load();
+            size_t stored = compression_stored_bytes.load();
+            std::cout << "\nCOMPRESSION:" << std::endl;
+            std::cout << "Uncompressed Data: " << std::fixed << std::setprecision(2) << (raw / (1024.0 * 1024.0)) << " MB" << std::endl;
+            std::cout << "Stored Data (framed): " << std::fixed << std::setprecision(2) << (stored / (1024.0 * 1024.0)) << " MB" << std::endl;
+            std::cout << "Compression Ratio: " << std::fixed << std::setprecision(2) << (stored > 0 ? double(raw) / stored : 0.0) << ":1" << std::endl;
+            std::cout << "Blocks Stored Compressed: " << compressed_blocks.load() << " of " << framed_blocks << std::endl;
+            if (duration_sec > 0) {
+                std::cout << "Stored MB/second: " << std::fixed << std::setprecision(2) << ((stored / (1024.0 * 1024.0)) / duration_sec) << std::endl;
+                std::cout << "Net MB/second (uncompressed): " << std::fixed << std::setprecision(2) << ((raw / (1024.0 * 1024.0)) / duration_sec) << std::endl;
+            }
+        }
 
         if (duration_sec > 0.000001) { // Avoid division by very small numbers
             std::cout << "\nPERFORMANCE METRICS:" << std::endl;
@@ -186,6 +318,50 @@ private:
             }
         }
 
+        if (roots.size() > 1) {
+            long long start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time.time_since_epoch()).count();
+            std::cout << "\nINPUT ROOTS (weighted fair share):" << std::endl;
+            for (size_t i = 0; i < roots.size() && i < MAX_ROOTS; i++) {
+                const RootCounters& done = root_counters[i];
+                double mb = done.bytes_completed.load() / (1024.0 * 1024.0);
+                long long last_ns = done.last_completion_ns.load();
+                std::cout << "[" << i << "] " << roots[i].path << " (weight " << roots[i].weight << "): "
+                          << done.files_completed.load() << "/" << roots[i].files << " files, "
+                          << std::fixed << std::setprecision(2) << mb << " MB";
+                if (last_ns > 0) {
+                    double finished_sec = (last_ns - start_ns) / 1e9;
+                    std::cout << ", finished at " << std::setprecision(3) << finished_sec << " s, "
+                              << std::setprecision(2) << (finished_sec > 0 ? mb / finished_sec : 0.0) << " MB/s";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        const BufferPool::Stats& pool = BufferPool::instance().stats();
+        size_t pool_requests = pool.hits.load() + pool.misses.load();
+        std::cout << "\nBUFFER POOL:" << std::endl;
+        std::cout << "Block Size: " << BufferPool::instance().blockSize() / 1024 << " KB" << std::endl;
+        if (pool_requests > 0) {
+            std::cout << "Pool Hit Rate: " << std::fixed << std::setprecision(1)
+                      << (double(pool.hits.load()) / pool_requests) * 100.0 << "% ("
+                      << pool.hits.load() << " hits, " << pool.misses.load() << " allocations)" << std::endl;
+        } else {
+            std::cout << "Pool Hit Rate: N/A" << std::endl;
+        }
+        std::cout << "Peak Buffers In Flight: " << std::fixed << std::setprecision(2)
+                  << pool.peakBytesInFlight.load() / (1024.0 * 1024.0) << " MB of "
+                  << BufferPool::instance().budget() / (1024.0 * 1024.0) << " MB budget" << std::endl;
+        std::cout << "Backpressure Waits: " << pool.waits.load() << std::endl;
+
+        long cached_kb_at_end = read_page_cache_kb();
+        if (cached_kb_at_start >= 0 && cached_kb_at_end >= 0) {
+            std::cout << "\nPAGE CACHE:" << std::endl;
+            std::cout << "Cached Before: " << std::fixed << std::setprecision(2) << cached_kb_at_start / 1024.0 << " MB" << std::endl;
+            std::cout << "Cached After: " << std::fixed << std::setprecision(2) << cached_kb_at_end / 1024.0 << " MB" << std::endl;
+            std::cout << "Page Cache Change: " << std::showpos << std::fixed << std::setprecision(2)
+                      << (cached_kb_at_end - cached_kb_at_start) / 1024.0 << std::noshowpos << " MB" << std::endl;
+        }
+
         std::cout << "\nMULTITHREAD INFO:" << std::endl;
         std::cout << "CPU Cores Available: " << std::thread::hardware_concurrency() << std::endl;
         std::cout << "Main Thread ID: " << main_thread_id << std::endl;
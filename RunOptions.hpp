@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "src/app/concurrency/ConcurrencyController.hpp"
+#include "src/app/FileHandling/BufferPool.hpp"
+#include "src/app/encryptDecrypt/CipherPolicy.hpp"
+
+// Command line flags shared by the multiprocess and multithreaded front ends
+struct RunOptions {
+    // A directory to encrypt/decrypt and its share of the workers
+    struct InputRoot {
+        std::string path;
+        unsigned weight = 1;
+    };
+
+    int minWorkers = 1;
+    int maxWorkers = ConcurrencyController::defaultMaxWorkers();
+    size_t blockSize = BufferPool::DEFAULT_BLOCK_SIZE;
+    size_t memoryBudget = BufferPool::DEFAULT_BUDGET;
+    bool hugePages = false;
+    bool directIO = false;
+    bool skipHoles = false;
+    std::string socketPath = "/tmp/encryptdecrypt.sock";
+    std::string checksumLog;
+    bool extentOrder = false;
+    int readahead = 0;
+    std::string journal;
+    bool resume = false;
+    bool compress = false;
+    CipherKind cipher = CipherKind::Shift;
+    std::string archive;
+    std::string member;
+    std::string outputDirectory = ".";
+    // Non-flag arguments, e.g. "encrypt <directory>"
+    std::vector<std::string> positional;
+
+    // "DIR:N" weights a root N times the default of 1. An argument that is
+    // itself an existing directory is always taken as a plain path.
+    static bool parseRoot(const std::string& arg, InputRoot& root) {
+        root.path = arg;
+        root.weight = 1;
+        size_t colon = arg.rfind(':');
+        if (colon == std::string::npos || colon == 0 || std::filesystem::is_directory(arg)) {
+            return true;
+        }
+        std::string weight = arg.substr(colon + 1);
+        if (weight.empty() || weight.find_first_not_of("0123456789") != std::string::npos) {
+            return true;
+        }
+        try {
+            root.weight = static_cast<unsigned>(std::stoul(weight));
+        } catch (const std::exception&) {
+            root.weight = 0;
+        }
+        if (root.weight == 0) {
+            std::cerr << "Invalid weight for " << arg.substr(0, colon) << ": " << weight << std::endl;
+            return false;
+        }
+        root.path = arg.substr(0, colon);
+        return true;
+    }
+
+    // A root as a canonical path, so "d", "./d/" and a symlink to d match
+    static std::filesystem::path canonicalRoot(const std::string& root) {
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::weakly_canonical(root, ec);
+        if (ec) {
+            path = std::filesystem::absolute(root).lexically_normal();
+        }
+        if (path.filename().empty()) {
+            path = path.parent_path(); // trailing separator
+        }
+        return path;
+    }
+
+    // True if inner is outer itself or lies anywhere below it (both canonical)
+    static bool rootContains(const std::filesystem::path& outer, const std::filesystem::path& inner) {
+        return std::mismatch(outer.begin(), outer.end(), inner.begin(), inner.end()).first == outer.end();
+    }
+
+    // Roots must not overlap, or files under both would be queued twice
+    static bool checkRoots(const std::vector<InputRoot>& roots) {
+        std::vector<std::filesystem::path> canonical;
+        for (const auto& root : roots) {
+            canonical.push_back(canonicalRoot(root.path));
+        }
+        for (size_t a = 0; a < roots.size(); a++) {
+            for (size_t b = 0; b < roots.size(); b++) {
+                if (a != b && rootContains(canonical[a], canonical[b])) {
+                    std::cerr << "Input roots overlap: " << roots[b].path
+                              << (canonical[a] == canonical[b] ? " is the same directory as " : " is inside ")
+                              << roots[a].path << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static void usage(const char* program) {
+        std::cerr << "Usage: " << program << " [options] [encrypt|decrypt <directory>[:weight]... | verify <checksum log> | extract <archive>]\n"
+                  << "  --min-workers N      lower bound for the adaptive worker count (default 1)\n"
+                  << "  --max-workers N      upper bound for the adaptive worker count\n"
+                  << "  --block-size KB      transform block size (default 1024)\n"
+                  << "  --memory-budget MB   cap on I/O buffer bytes in flight (default 64)\n"
+                  << "  --huge-pages         back I/O buffers with huge pages when available\n"
+                  << "  --direct-io          bypass the page cache (O_DIRECT) for one-shot bulk passes\n"
+                  << "  --skip-holes         leave holes in sparse files as holes (see README before using)\n"
+                  << "  --compress           compress each block before encrypting it\n"
+                  << "  --cipher NAME        shift (default) or chacha20; decrypt detects chacha20 files\n"
+                  << "  --checksum-log PATH  record CRC32C of every file before/after the transform\n"
+                  << "  --extent-order       submit files in physical on-disk order (FIEMAP)\n"
+                  << "  --readahead N        prefetch the next N queued files (default 0)\n"
+                  << "  --journal PATH       record progress so an interrupted run can be resumed\n"
+                  << "  --resume             continue the run recorded in --journal\n"
+                  << "  --archive PREFIX     encrypt into packed segment files PREFIX.NNNN.seg + PREFIX.idx\n"
+                  << "  --member NAME        extract only this archive member\n"
+                  << "  --output DIR         directory to extract into (default .)\n"
+                  << "  --socket PATH        UNIX socket of the job daemon (default /tmp/encryptdecrypt.sock)" << std::endl;
+    }
+
+    // Returns false (after printing usage) on a bad flag
+    bool parse(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            std::string flag = argv[i];
+            if (flag.rfind("--", 0) != 0) {
+                positional.push_back(flag);
+                continue;
+            }
+            if (flag == "--huge-pages") {
+                hugePages = true;
+                continue;
+            }
+            if (flag == "--direct-io") {
+                directIO = true;
+                continue;
+            }
+            if (flag == "--skip-holes") {
+                skipHoles = true;
+                continue;
+            }
+            if (flag == "--extent-order") {
+                extentOrder = true;
+                continue;
+            }
+            if (flag == "--compress") {
+                compress = true;
+                continue;
+            }
+            if (flag == "--resume") {
+                resume = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for option: " << flag << std::endl;
+                usage(argv[0]);
+                return false;
+            }
+            std::string value = argv[++i];
+            try {
+                if (flag == "--min-workers") {
+                    minWorkers = std::stoi(value);
+                } else if (flag == "--max-workers") {
+                    maxWorkers = std::stoi(value);
+                } else if (flag == "--block-size") {
+                    blockSize = std::stoul(value) * 1024;
+                } else if (flag == "--memory-budget") {
+                    memoryBudget = std::stoul(value) * 1024 * 1024;
+                } else if (flag == "--cipher") {
+                    if (!cipherFromString(value, cipher)) {
+                        std::cerr << "Unknown cipher: " << value << " (expected shift or chacha20)" << std::endl;
+                        return false;
+                    }
+                } else if (flag == "--checksum-log") {
+                    checksumLog = value;
+                } else if (flag == "--readahead") {
+                    readahead = std::max(0, std::stoi(value));
+                } else if (flag == "--journal") {
+                    journal = value;
+                } else if (flag == "--archive") {
+                    archive = value;
+                } else if (flag == "--member") {
+                    member = value;
+                } else if (flag == "--output") {
+                    outputDirectory = value;
+                } else if (flag == "--socket") {
+                    socketPath = value;
+                } else {
+                    std::cerr << "Unknown option: " << flag << std::endl;
+                    usage(argv[0]);
+                    return false;
+                }
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << flag << ": " << value << std::endl;
+                return false;
+            }
+        }
+        if (directIO) {
+            // Prefetching into the cache is exactly what --direct-io avoids
+            readahead = 0;
+        }
+        if (resume && journal.empty()) {
+            std::cerr << "--resume needs the --journal of the interrupted run" << std::endl;
+            return false;
+        }
+        if (!archive.empty() && compress) {
+            std::cerr << "--compress applies to in-place runs; it cannot be combined with --archive" << std::endl;
+            return false;
+        }
+        if (cipher == CipherKind::ChaCha20 && (compress || !archive.empty())) {
+            std::cerr << "--cipher chacha20 applies to plain in-place runs; it cannot be combined with --compress or --archive" << std::endl;
+            return false;
+        }
+        if (!archive.empty() && !journal.empty()) {
+            std::cerr << "--journal tracks in-place runs; it cannot be combined with --archive" << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,80 @@
+#include "RunOptions.hpp"
+#include<iostream>
+#include<filesystem>
+#include<cstring>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+
+namespace fs = std::filesystem;
+
+// Thin client for the job daemon: sends one job and prints the streamed
+// per-file status and final metrics. Exits non-zero if any file failed.
+int main(int argc, char *argv[]){
+    RunOptions options;
+    if(!options.parse(argc, argv)){
+        return 1;
+    }
+    if(options.positional.size() != 2){
+        RunOptions::usage(argv[0]);
+        return 1;
+    }
+    std::string action = options.positional[0];
+    RunOptions::InputRoot root;
+    if(!RunOptions::parseRoot(options.positional[1], root)){
+        return 1;
+    }
+    // The daemon has its own working directory, so always send an absolute path
+    std::string directory = fs::absolute(root.path).string();
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, options.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0){
+        std::cerr<<"Unable to connect to daemon at "<<options.socketPath<<": "<<strerror(errno)<<std::endl;
+        return 1;
+    }
+
+    std::string request = action;
+    if(options.directIO){
+        request += " --direct-io";
+    }
+    if(options.skipHoles){
+        request += " --skip-holes";
+    }
+    if(options.compress){
+        request += " --compress";
+    }
+    if(options.cipher != CipherKind::Shift){
+        request += " --cipher " + std::string(cipherName(options.cipher));
+    }
+    if(root.weight != 1){
+        request += " --weight " + std::to_string(root.weight);
+    }
+    request += " " + directory + "\n";
+    if(send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())){
+        std::cerr<<"Unable to send job: "<<strerror(errno)<<std::endl;
+        close(fd);
+        return 1;
+    }
+
+    int exitCode = 1;
+    std::string pending;
+    char buffer[4096];
+    ssize_t n;
+    while((n = recv(fd, buffer, sizeof(buffer), 0)) > 0){
+        pending.append(buffer, n);
+        size_t newline;
+        while((newline = pending.find('\n')) != std::string::npos){
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            std::cout<<line<<std::endl;
+            if(line.rfind("DONE ", 0) == 0){
+                exitCode = (line.find(" failed=0 ") != std::string::npos) ? 0 : 1;
+            }
+        }
+    }
+    close(fd);
+    return exitCode;
+}
@@ -0,0 +1,47 @@
+#include "BenchmarkLogger2.hpp"
+#include "RunOptions.hpp"
+#include<iostream>
+#include<csignal>
+#include "./src/app/daemon/JobServer.hpp"
+#include "./src/app/threads/ThreadManagement.hpp"
+
+namespace {
+    JobServer *activeServer = nullptr;
+
+    void onTerminate(int){
+        if(activeServer != nullptr){
+            activeServer->stop();
+        }
+    }
+}
+
+// Long-running job server: the worker pool, buffer pool and key stay warm
+// between jobs, which arrive over a UNIX socket (see JobServer.hpp).
+int main(int argc, char *argv[]){
+    RunOptions options;
+    if(!options.parse(argc, argv)){
+        return 1;
+    }
+    BufferPool::instance().configure(options.blockSize, options.memoryBudget, options.hugePages);
+    BufferPool::instance().prefill(options.maxWorkers);
+
+    BenchmarkLogger2 benchmark("Daemon jobs");
+    ThreadManagement threadManagement(options.minWorkers, options.maxWorkers);
+    JobServer server(options.socketPath, threadManagement);
+    if(!server.start()){
+        return 1;
+    }
+
+    activeServer = &server;
+    struct sigaction sa{};
+    sa.sa_handler = onTerminate;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    server.serve();
+    activeServer = nullptr;
+
+    threadManagement.executeTasks();
+    return 0;
+}
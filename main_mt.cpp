@@ -1,6 +1,19 @@
 #include "BenchmarkLogger2.hpp"
+#include "RunOptions.hpp"
+#include<algorithm>
 #include<iostream>
 #include<filesystem>
+#include<iomanip>
+#include<sstream>
+#include<vector>
+#include "./src/app/concurrency/FairShare.hpp"
+#include "./src/app/encryptDecrypt/ChaCha20.hpp"
+#include "./src/app/encryptDecrypt/Compression.hpp"
+#include "./src/app/FileHandling/BlockIO.hpp"
+#include "./src/app/FileHandling/ChecksumLog.hpp"
+#include "./src/app/FileHandling/DiskLayout.hpp"
+#include "./src/app/FileHandling/PackedArchive.hpp"
+#include "./src/app/FileHandling/ProgressJournal.hpp"
 #include "./src/app/threads/ThreadManagement.hpp"
 #include "./src/app/threads/Task.hpp"
 
@@ -9,43 +22,270 @@ namespace fs = std::filesystem;
 int main(int argc, char *argv[]){
     std::string directory;
     std::string action;
+    std::vector<RunOptions::InputRoot> roots;
+    RunOptions options;
+    if(!options.parse(argc, argv)){
+        return 1;
+    }
+    BufferPool::instance().configure(options.blockSize, options.memoryBudget, options.hugePages);
+
+    if(options.positional.size() >= 2){
+        action = options.positional[0];
+        directory = options.positional[1];
+    }else{
+        std::cout<<"Enter the directory (checksum log for verify, archive for extract): ";
+        std::getline(std::cin, directory);
+
+        std::cout<<"Enter the action(encrypt/decrypt/verify/extract): ";
+        std::getline(std::cin, action);
+    }
 
-    std::cout<<"Enter the directory: ";
-    std::getline(std::cin, directory);
+    if(action == "encrypt" || action == "decrypt"){
+        // Every further argument is another root sharing the workers
+        std::vector<std::string> rootArgs(1, directory);
+        if(options.positional.size() > 2){
+            rootArgs.assign(options.positional.begin() + 1, options.positional.end());
+        }
+        for(const auto &arg : rootArgs){
+            RunOptions::InputRoot root;
+            if(!RunOptions::parseRoot(arg, root)){
+                return 1;
+            }
+            roots.push_back(root);
+        }
+        if(!RunOptions::checkRoots(roots)){
+            return 1;
+        }
+        directory = roots.front().path;
+    }else if(options.positional.size() > 2){
+        std::cerr<<"Only encrypt and decrypt take several directories"<<std::endl;
+        return 1;
+    }
 
-    std::cout<<"Enter the action(encrypt/decrypt): ";
-    std::getline(std::cin, action);
+    if(!options.journal.empty() && (action == "encrypt" || action == "decrypt")){
+        std::string error;
+        if(!ProgressJournal::instance().open(options.journal, action, BufferPool::instance().blockSize(), options.resume, error)){
+            std::cerr<<"Journal error: "<<error<<std::endl;
+            return 1;
+        }
+    }
+    if(!options.archive.empty()){
+        std::string error;
+        if(action != "encrypt"){
+            std::cerr<<"--archive packs an encrypt run; read archives back with extract"<<std::endl;
+            return 1;
+        }
+        if(roots.size() > 1){
+            std::cerr<<"--archive packs a single directory"<<std::endl;
+            return 1;
+        }
+        if(!PackedArchive::instance().create(options.archive, directory, error)){
+            std::cerr<<"Archive error: "<<error<<std::endl;
+            return 1;
+        }
+    }
 
     BenchmarkLogger2 benchmark("Multithreaded " + action + "ion"); 
 
     try
     {
-        if(fs::exists(directory) && fs::is_directory(directory)){
-            ThreadManagement threadManagement; 
+        if(action == "verify"){
+            // For verify, the path is the checksum log written by an earlier run
+            ThreadManagement threadManagement(options.minWorkers, options.maxWorkers);
+
+            for(const auto &logged : ChecksumLog::load(directory)){
+                auto task = std::make_unique<Task>(std::fstream(), Action::VERIFY, logged.path);
+                task->options.directIO = options.directIO;
+                task->options.expectedCrc = logged.crcOut;
+                task->options.expectedSize = logged.bytes;
+                threadManagement.SubmitToQueue(std::move(task));
+
+                BenchmarkLogger2::record_file_operation(logged.path, true);
+            }
+            BenchmarkLogger2::log("Verifying checksums...");
+            threadManagement.executeTasks();
+
+            BenchmarkLogger2::log("Verification completed");
+        }else if(action == "extract"){
+            // For extract, the path is the prefix given to --archive when packing
+            std::string error;
+            PackedArchive &archive = PackedArchive::instance();
+            if(!archive.openForRead(directory, options.outputDirectory, error)){
+                std::cerr<<"Archive error: "<<error<<std::endl;
+            }else{
+                ThreadManagement threadManagement(options.minWorkers, options.maxWorkers);
+
+                std::vector<std::string> members;
+                if(!options.member.empty()){
+                    members.push_back(options.member);
+                }else{
+                    for(size_t i = 0; i < archive.memberCount(); i++){
+                        members.push_back(archive.memberNameAt(i));
+                    }
+                }
+                for(const auto &member : members){
+                    threadManagement.SubmitToQueue(std::make_unique<Task>(std::fstream(), Action::EXTRACT, member));
+
+                    BenchmarkLogger2::record_file_operation(member, true);
+                }
+                BenchmarkLogger2::log("Extracting archive members...");
+                threadManagement.executeTasks();
 
-            for(const auto &entry : fs::recursive_directory_iterator(directory)){
-                if(entry.is_regular_file()){
-                    std::string filePath = entry.path().string();
-                    IO io(filePath);
-                    std::fstream f_stream = std::move(io.getFileStream());
+                BenchmarkLogger2::log("Extraction completed");
+            }
+        }else if(!roots.empty() && std::all_of(roots.begin(), roots.end(), [](const RunOptions::InputRoot &root){
+                     return fs::is_directory(root.path);
+                 })){
+            ThreadManagement threadManagement(options.minWorkers, options.maxWorkers);
+            threadManagement.setReadahead(options.readahead);
 
-                    if(f_stream.is_open()){
-                        Action taskAction = (action == "encrypt") ? Action::ENCRYPT : Action::DECRYPT;
-                        auto task = std::make_unique<Task>(std::move(f_stream), taskAction, filePath);
-                        threadManagement.SubmitToQueue(std::move(task));
+            std::vector<std::vector<std::string>> rootFiles(roots.size());
+            for(size_t r = 0; r < roots.size(); r++){
+                for(const auto &entry : fs::recursive_directory_iterator(roots[r].path)){
+                    // Leftovers of an interrupted --compress run are not inputs
+                    if(entry.is_regular_file() && entry.path().extension() != Frame::TEMPORARY_SUFFIX){
+                        rootFiles[r].push_back(entry.path().string());
+                    }
+                }
+            }
 
-                        BenchmarkLogger2::record_file_operation(filePath, true);
-                    }else{
-                        std::cout<<"Unable to open the file: "<<filePath<<std::endl;
+            ProgressJournal &journal = ProgressJournal::instance();
+            if(journal.isOpen()){
+                // Files the interrupted run finished are not touched again;
+                // partially done ones go through the chunk checks in the worker
+                size_t listed = 0;
+                size_t remaining = 0;
+                for(auto &files : rootFiles){
+                    listed += files.size();
+                    files.erase(std::remove_if(files.begin(), files.end(), [&journal](const std::string &path){
+                        const ProgressJournal::FileProgress *progress = journal.recovered(path);
+                        return progress != nullptr && progress->complete;
+                    }), files.end());
+                    remaining += files.size();
+                }
+                std::ostringstream detail;
+                detail<<options.journal;
+                if(options.resume){
+                    detail<<" (resumed: "<<listed - remaining<<" files already done, "
+                          <<journal.recoveredPartial()<<" partially done)";
+                }
+                BenchmarkLogger2::set_run_detail("Progress Journal", detail.str());
+            }
 
-                        BenchmarkLogger2::record_file_operation(filePath, false);
+            if(options.extentOrder){
+                // Submit in on-disk order so spinning/network disks read sequentially
+                auto start = std::chrono::steady_clock::now();
+                size_t mapped = 0;
+                size_t listed = 0;
+                for(auto &files : rootFiles){
+                    mapped += DiskLayout::sortByPhysicalOffset(files);
+                    listed += files.size();
+                }
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::ostringstream detail;
+                detail<<"physical extent ("<<mapped<<"/"<<listed<<" files mapped, pre-pass "
+                      <<std::fixed<<std::setprecision(1)<<ms<<" ms)";
+                BenchmarkLogger2::set_run_detail("Submission Order", detail.str());
+            }else{
+                BenchmarkLogger2::set_run_detail("Submission Order", "directory");
+            }
+            // Several roots share the workers by weight. Submitting them in the
+            // scheduler's own order keeps a big root from filling the queue
+            // ahead of a small urgent one.
+            std::vector<std::string> filePaths;
+            std::vector<size_t> fileRoots;
+            if(roots.size() == 1){
+                filePaths = std::move(rootFiles.front());
+                fileRoots.assign(filePaths.size(), 0);
+            }else{
+                std::vector<std::vector<size_t>> costs(roots.size());
+                std::vector<unsigned> weights;
+                for(size_t r = 0; r < roots.size(); r++){
+                    weights.push_back(roots[r].weight);
+                    for(const auto &path : rootFiles[r]){
+                        std::error_code ec;
+                        uintmax_t bytes = fs::file_size(path, ec);
+                        costs[r].push_back(FairShare::taskCost(ec ? 0 : static_cast<size_t>(bytes)));
                     }
+                    BenchmarkLogger2::add_root(roots[r].path, roots[r].weight, rootFiles[r].size());
+                }
+                for(const auto &next : FairShare::order(costs, weights)){
+                    filePaths.push_back(rootFiles[next.first][next.second]);
+                    fileRoots.push_back(next.first);
+                }
+                BenchmarkLogger2::set_run_detail("Input Roots", std::to_string(roots.size()) + " (weighted fair queueing)");
+            }
+            BenchmarkLogger2::set_run_detail("Readahead Window", options.directIO ? std::string("off (--direct-io bypasses the page cache)")
+                                  : std::to_string(options.readahead) + " files");
+            if(options.directIO && !filePaths.empty()){
+                // Some filesystems refuse O_DIRECT; BlockIO then quietly uses the page cache
+                bool supported = BlockIO(filePaths.front(), false, false, true).isDirect();
+                // Frames and archive segments are not block-aligned, so those
+                // transfers fall back to the page cache
+                bool framed = options.compress || options.cipher != CipherKind::Shift || !options.archive.empty();
+                if(!supported){
+                    BenchmarkLogger2::set_run_detail("I/O Mode", "buffered (filesystem does not support O_DIRECT)");
+                }else if(action == "encrypt" && framed){
+                    BenchmarkLogger2::set_run_detail("I/O Mode", "buffered (compressed, chacha20 and archive output is not block-aligned)");
+                }else if(action == "decrypt"){
+                    BenchmarkLogger2::set_run_detail("I/O Mode", "O_DIRECT for in-place files, buffered for compressed and chacha20 files");
+                }else{
+                    BenchmarkLogger2::set_run_detail("I/O Mode", "O_DIRECT (page cache bypassed)");
+                }
+            }else{
+                BenchmarkLogger2::set_run_detail("I/O Mode", "buffered");
+            }
+            if(action == "encrypt"){
+                BenchmarkLogger2::set_run_detail("Cipher", options.cipher == CipherKind::ChaCha20
+                                      ? std::string("chacha20 (") + ChaCha20::engineName() + ")" : "shift");
+            }else{
+                BenchmarkLogger2::set_run_detail("Cipher", std::string("from each file (chacha20 engine: ") + ChaCha20::engineName() + ")");
+            }
+
+            for(size_t i = 0; i < filePaths.size(); i++){
+                const std::string &filePath = filePaths[i];
+                IO io(filePath);
+                std::fstream f_stream = std::move(io.getFileStream());
+
+                if(f_stream.is_open()){
+                    Action taskAction = (action == "encrypt") ? Action::ENCRYPT : Action::DECRYPT;
+                    auto task = std::make_unique<Task>(std::move(f_stream), taskAction, filePath);
+                    task->options.checksumLog = options.checksumLog;
+                    task->options.compress = options.compress;
+                    task->options.cipher = options.cipher;
+                    task->options.directIO = options.directIO;
+                    task->options.skipHoles = options.skipHoles;
+                    task->options.root = fileRoots[i];
+                    threadManagement.SubmitToQueue(std::move(task), static_cast<int>(fileRoots[i]), nullptr, roots[fileRoots[i]].weight);
+
+                    BenchmarkLogger2::record_file_operation(filePath, true);
+                }else{
+                    std::cout<<"Unable to open the file: "<<filePath<<std::endl;
+
+                    BenchmarkLogger2::record_file_operation(filePath, false);
                 }
             }
             BenchmarkLogger2::log("About to execute tasks...");
-            // run tasks
+            // wait for the workers to drain the queue
             threadManagement.executeTasks();
 
+            PackedArchive &archive = PackedArchive::instance();
+            if(archive.isWriting()){
+                std::string error;
+                long members = archive.finish(error);
+                if(members < 0){
+                    std::cerr<<"Archive error: "<<error<<std::endl;
+                }else{
+                    BenchmarkLogger2::set_run_detail("Packed Archive", options.archive + " (" + std::to_string(members) + " members in "
+                                          + std::to_string(archive.segmentCount()) + " segments)");
+                }
+            }
+            if(journal.isOpen()){
+                journal.sync();
+                BenchmarkLogger2::set_run_detail("Journal Records", std::to_string(journal.stats().records.load()) + " in "
+                                      + std::to_string(journal.stats().syncs.load()) + " syncs");
+            }
+
             BenchmarkLogger2::log("Tasks execution completed");
         }else{
             std::cout<<"Invalid directory Path!"<<std::endl;
@@ -0,0 +1,127 @@
+#include<algorithm>
+#include<iostream>
+#include<filesystem>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<unistd.h>
+#include "./src/app/scaling/ScalingStudy.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    void usage(const char *program){
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --workers LIST       worker counts to sweep (default 1,2,4,... up to the core count)\n"
+                  << "  --block-sizes LIST   block sizes in KB (default 1024)\n"
+                  << "  --backends LIST      process and/or thread (default process,thread)\n"
+                  << "  --corpora LIST       small, mixed and/or large (default small,mixed)\n"
+                  << "  --repeat N           runs per point, the median is kept (default 3)\n"
+                  << "  --scratch DIR        where corpora are generated (default $TMPDIR/encrypt_decrypt_scaling)\n"
+                  << "  --bin-dir DIR        directory holding encrypt_decrypt and encrypt_decrypt_mt\n"
+                  << "                       (default: next to this program)\n"
+                  << "  --csv PATH           also write the results as CSV" << std::endl;
+    }
+
+    std::vector<std::string> splitList(const std::string &value){
+        std::vector<std::string> items;
+        std::stringstream ss(value);
+        std::string item;
+        while(std::getline(ss, item, ',')){
+            if(!item.empty()){
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+}
+
+// Scaling study over the real executors; see ScalingStudy.hpp
+int main(int argc, char *argv[]){
+    ScalingStudy::Options options;
+    int cores = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    for(int workers = 1; workers < cores; workers *= 2){
+        options.workers.push_back(workers);
+    }
+    options.workers.push_back(cores);
+    options.scratch = (fs::temp_directory_path() / "encrypt_decrypt_scaling").string();
+    options.binaryDir = fs::read_symlink("/proc/self/exe").parent_path().string();
+
+    for(int i = 1; i < argc; i++){
+        std::string flag = argv[i];
+        if(i + 1 >= argc){
+            std::cerr<<"Missing value for option: "<<flag<<std::endl;
+            usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        try{
+            if(flag == "--workers"){
+                options.workers.clear();
+                for(const auto &item : splitList(value)){
+                    options.workers.push_back(std::max(1, std::stoi(item)));
+                }
+            }else if(flag == "--block-sizes"){
+                options.blockSizesKB.clear();
+                for(const auto &item : splitList(value)){
+                    options.blockSizesKB.push_back(std::stoul(item));
+                }
+            }else if(flag == "--backends"){
+                options.backends = splitList(value);
+            }else if(flag == "--corpora"){
+                options.corpora = splitList(value);
+            }else if(flag == "--repeat"){
+                options.repeat = std::max(1, std::stoi(value));
+            }else if(flag == "--scratch"){
+                options.scratch = fs::absolute(value).string();
+            }else if(flag == "--bin-dir"){
+                options.binaryDir = fs::absolute(value).string();
+            }else if(flag == "--csv"){
+                options.csvPath = value;
+            }else{
+                std::cerr<<"Unknown option: "<<flag<<std::endl;
+                usage(argv[0]);
+                return 1;
+            }
+        }catch(const std::exception &){
+            std::cerr<<"Invalid value for "<<flag<<": "<<value<<std::endl;
+            return 1;
+        }
+    }
+
+    for(const auto &backend : options.backends){
+        if(backend != "process" && backend != "thread"){
+            std::cerr<<"Unknown backend: "<<backend<<std::endl;
+            return 1;
+        }
+    }
+    for(const auto &corpus : options.corpora){
+        bool known = false;
+        for(const auto &shape : ScalingStudy::shapes()){
+            known = known || shape.name == corpus;
+        }
+        if(!known){
+            std::cerr<<"Unknown corpus: "<<corpus<<std::endl;
+            return 1;
+        }
+    }
+    if(options.workers.empty() || options.blockSizesKB.empty() || options.backends.empty() || options.corpora.empty()){
+        usage(argv[0]);
+        return 1;
+    }
+    std::sort(options.workers.begin(), options.workers.end());
+    options.workers.erase(std::unique(options.workers.begin(), options.workers.end()), options.workers.end());
+
+    ScalingStudy study(options);
+    bool ok = study.run();
+    study.printTable();
+    if(!options.csvPath.empty()){
+        if(study.writeCsv(options.csvPath)){
+            std::cout<<"\nCSV written to "<<options.csvPath<<std::endl;
+        }else{
+            std::cerr<<"Unable to write "<<options.csvPath<<std::endl;
+            return 1;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#include "BlockIO.hpp"
+#include<algorithm>
+#include<iostream>
+#include<cerrno>
+#include<cstdint>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+namespace {
+    inline bool isAligned(uintptr_t value) {
+        return value % BlockIO::DIRECT_ALIGNMENT == 0;
+    }
+
+    inline size_t roundUp(size_t value) {
+        return (value + BlockIO::DIRECT_ALIGNMENT - 1) / BlockIO::DIRECT_ALIGNMENT * BlockIO::DIRECT_ALIGNMENT;
+    }
+
+    ssize_t readFully(int fd, char *buffer, size_t length, off_t offset, bool direct = false) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pread(fd, buffer + done, length - done, offset + done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += n;
+            if (direct && !isAligned(n)) {
+                break; // EOF; retrying at an unaligned offset would fail with EINVAL
+            }
+        }
+        return done;
+    }
+
+    ssize_t writeFully(int fd, const char *buffer, size_t length, off_t offset) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pwrite(fd, buffer + done, length - done, offset + done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            done += n;
+        }
+        return done;
+    }
+}
+
+BlockIO::BlockIO(const std::string &file_path, bool writable, bool create, bool directIO) {
+    int flags = (writable || create) ? O_RDWR : O_RDONLY;
+    if (create) {
+        flags |= O_CREAT | O_TRUNC;
+    }
+    fd = -1;
+    if (directIO) {
+        fd = open(file_path.c_str(), flags | O_CLOEXEC | O_DIRECT, 0644);
+        direct = fd >= 0;
+    }
+    if (fd < 0) {
+        // EINVAL: the filesystem (e.g. older tmpfs) has no direct I/O
+        fd = open(file_path.c_str(), flags | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) {
+        std::cout << "Unable to open file: " << file_path << std::endl;
+    }
+}
+
+BlockIO::~BlockIO() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+off_t BlockIO::size() const {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    return st.st_size;
+}
+
+off_t BlockIO::allocatedSize() const {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    return static_cast<off_t>(st.st_blocks) * 512;
+}
+
+std::vector<BlockIO::Extent> BlockIO::dataExtents() const {
+    std::vector<Extent> extents;
+    off_t end = size();
+    off_t position = 0;
+    while (position < end) {
+        off_t data = lseek(fd, position, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                break; // only a hole left up to EOF
+            }
+            // SEEK_DATA unsupported: treat the file as dense
+            extents.clear();
+            extents.push_back(Extent{0, end});
+            return extents;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0 || hole > end) {
+            hole = end;
+        }
+        if (hole > data) {
+            extents.push_back(Extent{data, hole - data});
+        }
+        position = hole;
+    }
+    return extents;
+}
+
+bool BlockIO::setDirect(bool enable) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT)) == 0;
+}
+
+ssize_t BlockIO::readAt(char *buffer, size_t length, off_t offset, size_t capacity) {
+    if (!direct || length == 0) {
+        return readFully(fd, buffer, length, offset);
+    }
+    if (isAligned(reinterpret_cast<uintptr_t>(buffer)) && isAligned(offset) &&
+        (isAligned(length) || roundUp(length) <= capacity)) {
+        // Asking for the rounded-up length is allowed; the kernel stops at
+        // EOF, which is the only place an unaligned length should occur
+        ssize_t n = readFully(fd, buffer, roundUp(length), offset, true);
+        return n < 0 ? n : std::min<ssize_t>(n, length);
+    }
+    setDirect(false);
+    ssize_t n = readFully(fd, buffer, length, offset);
+    setDirect(true);
+    return n;
+}
+
+ssize_t BlockIO::writeAt(const char *buffer, size_t length, off_t offset) {
+    if (!direct || length == 0 ||
+        (isAligned(reinterpret_cast<uintptr_t>(buffer)) && isAligned(offset) && isAligned(length))) {
+        return writeFully(fd, buffer, length, offset);
+    }
+    // The unaligned tail goes through the page cache rather than being
+    // padded and truncated back, so a crash can never leave the file
+    // longer than it was. That costs at most one cached page per file.
+    setDirect(false);
+    ssize_t n = writeFully(fd, buffer, length, offset);
+    setDirect(true);
+    return n;
+}
@@ -0,0 +1,56 @@
+#ifndef BLOCK_IO_HPP
+#define BLOCK_IO_HPP
+
+#include<string>
+#include<vector>
+#include<sys/types.h>
+
+// Positional block reads/writes on a raw descriptor, used by the transform
+// loop instead of the char-at-a-time fstream in IO.
+class BlockIO {
+    public:
+      struct Extent {
+        off_t offset;
+        off_t length;
+      };
+
+      // Direct I/O transfers must start on, and span a multiple of, this
+      static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+      // create truncates or creates the file (implies writable). direct
+      // opens with O_DIRECT, bypassing the page cache; filesystems that
+      // refuse it get a buffered descriptor instead (see isDirect()).
+      BlockIO(const std::string &file_path, bool writable = true, bool create = false, bool direct = false);
+      ~BlockIO();
+      BlockIO(const BlockIO &) = delete;
+      BlockIO &operator=(const BlockIO &) = delete;
+
+      bool isOpen() const { return fd >= 0; }
+      bool isDirect() const { return direct; }
+      int descriptor() const { return fd; }
+      off_t size() const;
+      // Bytes actually allocated on disk (st_blocks), less than size() for sparse files
+      off_t allocatedSize() const;
+
+      // Ranges that hold data, found with SEEK_DATA/SEEK_HOLE; everything
+      // between them is a hole that reads as zeros. Filesystems without
+      // hole support report the whole file as one extent.
+      std::vector<Extent> dataExtents() const;
+
+      // Both loop over short transfers; readAt returns less than length only at EOF.
+      // In direct mode a transfer bypasses the cache only if the buffer and
+      // offset are DIRECT_ALIGNMENT-aligned, and for reads either length is
+      // too or capacity (the buffer's real size) has room for length rounded
+      // up to it. Anything else (the tail of a file, a header read into a
+      // small struct) goes through the page cache instead.
+      ssize_t readAt(char *buffer, size_t length, off_t offset, size_t capacity = 0);
+      ssize_t writeAt(const char *buffer, size_t length, off_t offset);
+    private:
+      bool setDirect(bool enable);
+
+      int fd;
+      bool direct = false;
+};
+
+
+#endif
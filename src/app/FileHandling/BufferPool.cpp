@@ -0,0 +1,271 @@
+#include "BufferPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+    size_t roundUp(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+struct BufferPool::ThreadCache
+{
+     BufferPool *pool = nullptr;
+     size_t generation = 0;
+     std::vector<char *> buffers;
+
+     ~ThreadCache() {
+          // Hand cached buffers to the global list so other threads can reuse them
+          if (pool == nullptr || buffers.empty()) {
+               return;
+          }
+          std::lock_guard<std::mutex> lock(pool->freeLock);
+          for (char *data : buffers) {
+               if (generation == pool->generation) {
+                    pool->freeList.push_back(data);
+               } else {
+                    pool->deallocate(data);
+               }
+          }
+     }
+};
+
+BufferPool::Buffer::Buffer(Buffer &&other) noexcept
+    : pool(other.pool), bytes(other.bytes), length(other.length) {
+    other.pool = nullptr;
+    other.bytes = nullptr;
+    other.length = 0;
+}
+
+BufferPool::Buffer &BufferPool::Buffer::operator=(Buffer &&other) noexcept {
+    if (this != &other) {
+        if (pool != nullptr) {
+            pool->release(bytes);
+        }
+        pool = other.pool;
+        bytes = other.bytes;
+        length = other.length;
+        other.pool = nullptr;
+        other.bytes = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer() {
+    if (pool != nullptr) {
+        pool->release(bytes);
+    }
+}
+
+BufferPool &BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::BufferPool() : shared(&localStats) {}
+
+BufferPool::~BufferPool() {
+    std::lock_guard<std::mutex> lock(freeLock);
+    for (char *data : freeList) {
+        deallocate(data);
+    }
+    freeList.clear();
+}
+
+void BufferPool::configure(size_t blockSize, size_t budget, bool hugePages) {
+    std::lock_guard<std::mutex> lock(freeLock);
+    for (char *data : freeList) {
+        deallocate(data);
+    }
+    freeList.clear();
+    generation++;
+
+    bufferSize = roundUp(std::max<size_t>(blockSize, ALIGNMENT), ALIGNMENT);
+    // A budget smaller than one buffer would deadlock the first acquire
+    budgetBytes = std::max(budget, bufferSize);
+    useHugePages = hugePages;
+
+    if (shared == &localStats) {
+        void *page = mmap(nullptr, sizeof(Stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (page != MAP_FAILED) {
+            shared = new (page) Stats();
+        }
+    }
+}
+
+BufferPool::ThreadCache &BufferPool::threadCache() {
+    thread_local ThreadCache cache;
+    if (cache.pool != this || cache.generation != generation) {
+        for (char *data : cache.buffers) {
+            deallocate(data);
+        }
+        cache.buffers.clear();
+        cache.pool = this;
+        cache.generation = generation;
+    }
+    return cache;
+}
+
+BufferPool::Buffer BufferPool::acquire() {
+    if (!reserve()) {
+        shared->waits.fetch_add(1);
+        std::unique_lock<std::mutex> lock(freeLock);
+        // Releases from other processes don't signal us, so re-check periodically
+        while (!reserve()) {
+            freed.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+    return take();
+}
+
+BufferPool::Buffer BufferPool::tryAcquire() {
+    if (!reserve()) {
+        return Buffer();
+    }
+    return take();
+}
+
+BufferPool::Buffer BufferPool::take() {
+    ThreadCache &cache = threadCache();
+    if (!cache.buffers.empty()) {
+        char *data = cache.buffers.back();
+        cache.buffers.pop_back();
+        shared->hits.fetch_add(1);
+        return Buffer(this, data, bufferSize);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(freeLock);
+        if (!freeList.empty()) {
+            char *data = freeList.back();
+            freeList.pop_back();
+            shared->hits.fetch_add(1);
+            return Buffer(this, data, bufferSize);
+        }
+    }
+
+    char *data = allocate();
+    if (data == nullptr) {
+        shared->bytesInFlight.fetch_sub(bufferSize);
+        chargeHolder(-static_cast<long long>(bufferSize));
+        throw std::bad_alloc();
+    }
+    shared->misses.fetch_add(1);
+    return Buffer(this, data, bufferSize);
+}
+
+void BufferPool::prefill(size_t count) {
+    std::lock_guard<std::mutex> lock(freeLock);
+    count = std::min(count, budgetBytes / bufferSize);
+    while (freeList.size() < count) {
+        char *data = allocate();
+        if (data == nullptr) {
+            break;
+        }
+        // Touch every page now rather than on the first job's critical path
+        std::fill(data, data + bufferSize, 0);
+        freeList.push_back(data);
+    }
+}
+
+bool BufferPool::reserve() {
+    size_t current = shared->bytesInFlight.load();
+    do {
+        if (current + bufferSize > budgetBytes) {
+            return false;
+        }
+    } while (!shared->bytesInFlight.compare_exchange_weak(current, current + bufferSize));
+
+    chargeHolder(static_cast<long long>(bufferSize));
+
+    size_t inFlight = current + bufferSize;
+    size_t peak = shared->peakBytesInFlight.load();
+    while (inFlight > peak && !shared->peakBytesInFlight.compare_exchange_weak(peak, inFlight)) {
+    }
+    return true;
+}
+
+void BufferPool::chargeHolder(long long bytes) {
+    pid_t self = getpid();
+    if (holderPid.load() != self) {
+        std::lock_guard<std::mutex> lock(holderLock);
+        if (holderPid.load() != self) {
+            holderSlot = -1;
+            for (size_t i = 0; i < MAX_HOLDERS; i++) {
+                pid_t free = 0;
+                if (shared->holders[i].pid.compare_exchange_strong(free, self)) {
+                    shared->holders[i].bytes.store(0);
+                    holderSlot = static_cast<int>(i);
+                    break;
+                }
+            }
+            holderPid.store(self);
+        }
+    }
+    if (holderSlot >= 0) {
+        shared->holders[holderSlot].bytes.fetch_add(bytes);
+    }
+}
+
+void BufferPool::reclaim(pid_t pid) {
+    for (auto &holder : shared->holders) {
+        if (holder.pid.load() == pid) {
+            long long held = holder.bytes.exchange(0);
+            if (held > 0) {
+                shared->bytesInFlight.fetch_sub(static_cast<size_t>(held));
+                freed.notify_all();
+            }
+            holder.pid.store(0);
+        }
+    }
+}
+
+void BufferPool::release(char *data) {
+    ThreadCache &cache = threadCache();
+    if (cache.buffers.size() < THREAD_CACHE_SIZE) {
+        cache.buffers.push_back(data);
+    } else {
+        std::lock_guard<std::mutex> lock(freeLock);
+        freeList.push_back(data);
+    }
+    shared->bytesInFlight.fetch_sub(bufferSize);
+    chargeHolder(-static_cast<long long>(bufferSize));
+    freed.notify_one();
+}
+
+char *BufferPool::allocate() {
+    if (useHugePages) {
+        size_t length = roundUp(bufferSize, HUGE_PAGE_SIZE);
+        void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            // No reserved hugetlbfs pages: ask for transparent huge pages instead
+            data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED) {
+                return nullptr;
+            }
+            madvise(data, length, MADV_HUGEPAGE);
+        }
+        return static_cast<char *>(data);
+    }
+
+    void *data = nullptr;
+    if (posix_memalign(&data, ALIGNMENT, bufferSize) != 0) {
+        return nullptr;
+    }
+    return static_cast<char *>(data);
+}
+
+void BufferPool::deallocate(char *data) {
+    if (useHugePages) {
+        munmap(data, roundUp(bufferSize, HUGE_PAGE_SIZE));
+    } else {
+        free(data);
+    }
+}
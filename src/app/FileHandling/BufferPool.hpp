@@ -0,0 +1,120 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
+
+// Fixed-size, page-aligned I/O buffers shared by every worker.
+// Each thread keeps a few released buffers for itself; the rest go back to
+// a global free list. The total size of buffers handed out is capped, so a
+// burst of large jobs waits for buffers instead of growing RSS.
+class BufferPool
+{
+public:
+     static constexpr size_t MAX_HOLDERS = 256;
+
+     struct Stats
+     {
+          std::atomic<size_t> hits{0};
+          std::atomic<size_t> misses{0};
+          std::atomic<size_t> waits{0};
+          std::atomic<size_t> bytesInFlight{0};
+          std::atomic<size_t> peakBytesInFlight{0};
+
+          // Budget each process holds, so the bytes of a forked worker that
+          // dies holding buffers can be given back (see reclaim())
+          struct Holder
+          {
+               std::atomic<pid_t> pid{0};
+               std::atomic<long long> bytes{0};
+          };
+          Holder holders[MAX_HOLDERS];
+     };
+
+     // RAII handle, returns the buffer to the pool when it goes out of scope
+     class Buffer
+     {
+     public:
+          Buffer() = default;
+          Buffer(BufferPool *pool, char *data, size_t size) : pool(pool), bytes(data), length(size) {}
+          Buffer(Buffer &&other) noexcept;
+          Buffer &operator=(Buffer &&other) noexcept;
+          Buffer(const Buffer &) = delete;
+          Buffer &operator=(const Buffer &) = delete;
+          ~Buffer();
+
+          char *data() const { return bytes; }
+          size_t size() const { return length; }
+
+     private:
+          BufferPool *pool = nullptr;
+          char *bytes = nullptr;
+          size_t length = 0;
+     };
+
+     static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+     static constexpr size_t DEFAULT_BUDGET = 64 << 20;
+     static constexpr size_t ALIGNMENT = 4096;
+
+     static BufferPool &instance();
+
+     // Must run before workers start (and before any fork) to take effect
+     void configure(size_t blockSize, size_t budgetBytes, bool hugePages);
+
+     Buffer acquire();
+     // Like acquire(), but returns an empty Buffer (data() == nullptr)
+     // instead of waiting when the budget is spent
+     Buffer tryAcquire();
+
+     // Allocate up to count buffers ahead of time (bounded by the budget)
+     // so the first jobs of a long-running process hit the free list
+     void prefill(size_t count);
+
+     // Return the budget still charged to an exited process. Called by the
+     // parent for every reaped worker; a no-op for one that released all.
+     void reclaim(pid_t pid);
+
+     size_t blockSize() const { return bufferSize; }
+     size_t budget() const { return budgetBytes; }
+     const Stats &stats() const { return *shared; }
+
+private:
+     BufferPool();
+     ~BufferPool();
+
+     void release(char *data);
+     bool reserve();
+     // Hand out a buffer whose budget reserve() has already charged
+     Buffer take();
+     char *allocate();
+     void deallocate(char *data);
+     void chargeHolder(long long bytes);
+
+     static constexpr size_t THREAD_CACHE_SIZE = 4;
+     struct ThreadCache;
+     ThreadCache &threadCache();
+
+     size_t bufferSize = DEFAULT_BLOCK_SIZE;
+     size_t budgetBytes = DEFAULT_BUDGET;
+     bool useHugePages = false;
+     size_t generation = 0;
+
+     Stats localStats;
+     Stats *shared; // MAP_SHARED once configured, so forked workers share the budget
+
+     // This process's entry in Stats::holders (-1 when the table was full);
+     // claimed on first use, and again after a fork
+     std::mutex holderLock;
+     std::atomic<pid_t> holderPid{0};
+     int holderSlot = -1;
+
+     std::mutex freeLock;
+     std::condition_variable freed;
+     std::vector<char *> freeList;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "ChecksumLog.hpp"
+#include<cstdio>
+#include<fstream>
+#include<map>
+#include<sstream>
+#include<fcntl.h>
+#include<unistd.h>
+
+bool ChecksumLog::append(const std::string &logPath, const Entry &entry) {
+    // Opened per line rather than cached: a long-running daemon sees a new
+    // log per job and would otherwise keep every one of them open
+    int fd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%08x %08x %llu ", entry.crcIn, entry.crcOut,
+             static_cast<unsigned long long>(entry.bytes));
+    std::string line = prefix + entry.path + "\n";
+    bool written = write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    close(fd);
+    return written;
+}
+
+std::vector<ChecksumLog::Entry> ChecksumLog::load(const std::string &logPath) {
+    std::ifstream in(logPath);
+    std::vector<Entry> entries;
+    std::map<std::string, size_t> index;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        Entry entry;
+        unsigned long long bytes;
+        iss >> std::hex >> entry.crcIn >> entry.crcOut >> std::dec >> bytes;
+        if (!iss || !std::getline(iss >> std::ws, entry.path) || entry.path.empty()) {
+            continue; // torn last line from an interrupted run
+        }
+        entry.bytes = bytes;
+        auto it = index.find(entry.path);
+        if (it != index.end()) {
+            entries[it->second] = entry;
+        } else {
+            index[entry.path] = entries.size();
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
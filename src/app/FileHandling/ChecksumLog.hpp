@@ -0,0 +1,28 @@
+#ifndef CHECKSUM_LOG_HPP
+#define CHECKSUM_LOG_HPP
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// Per-job record of the CRC32C of every file before and after its
+// transform, one "crc_in crc_out bytes path" line per file.
+class ChecksumLog {
+    public:
+      struct Entry {
+        uint32_t crcIn = 0;
+        uint32_t crcOut = 0;
+        uint64_t bytes = 0;
+        std::string path;
+      };
+
+      // One write() per line on an O_APPEND descriptor, so threads and
+      // forked workers appending to the same log never interleave
+      static bool append(const std::string &logPath, const Entry &entry);
+
+      // Latest entry for every path (a log may cover an encrypt and a later decrypt)
+      static std::vector<Entry> load(const std::string &logPath);
+};
+
+
+#endif
@@ -0,0 +1,79 @@
+#include "DiskLayout.hpp"
+#include<algorithm>
+#include<fcntl.h>
+#include<sys/ioctl.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<linux/fiemap.h>
+#include<linux/fs.h>
+
+uint64_t DiskLayout::firstPhysicalOffset(const std::string &file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return UNKNOWN_OFFSET;
+    }
+    // Room for exactly one extent: only the first one decides the order
+    alignas(struct fiemap) char request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+    struct fiemap *map = reinterpret_cast<struct fiemap *>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    uint64_t offset = UNKNOWN_OFFSET;
+    if (ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0 &&
+        !(map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN)) {
+        offset = map->fm_extents[0].fe_physical;
+    }
+    close(fd);
+    return offset;
+}
+
+size_t DiskLayout::sortByPhysicalOffset(std::vector<std::string> &paths) {
+    struct Keyed {
+        dev_t device;
+        uint64_t offset;
+        std::string path;
+    };
+    std::vector<Keyed> keyed;
+    keyed.reserve(paths.size());
+    size_t mapped = 0;
+    for (auto &path : paths) {
+        struct stat st;
+        dev_t device = (stat(path.c_str(), &st) == 0) ? st.st_dev : 0;
+        uint64_t offset = firstPhysicalOffset(path);
+        if (offset != UNKNOWN_OFFSET) {
+            mapped++;
+        }
+        keyed.push_back(Keyed{device, offset, std::move(path)});
+    }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) {
+        bool aKnown = a.offset != UNKNOWN_OFFSET;
+        bool bKnown = b.offset != UNKNOWN_OFFSET;
+        if (aKnown != bKnown) {
+            return aKnown;
+        }
+        if (!aKnown) {
+            return false;
+        }
+        if (a.device != b.device) {
+            return a.device < b.device;
+        }
+        return a.offset < b.offset;
+    });
+
+    for (size_t i = 0; i < keyed.size(); i++) {
+        paths[i] = std::move(keyed[i].path);
+    }
+    return mapped;
+}
+
+void DiskLayout::willNeed(const std::string &file_path, size_t window) {
+    int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    // Readahead outlives the descriptor: the pages stay in the cache
+    posix_fadvise(fd, 0, static_cast<off_t>(window), POSIX_FADV_WILLNEED);
+    close(fd);
+}
@@ -0,0 +1,34 @@
+#ifndef DISK_LAYOUT_HPP
+#define DISK_LAYOUT_HPP
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// Helpers for spinning and network-backed disks, where the order files are
+// read in matters as much as how they are read.
+class DiskLayout {
+    public:
+      static constexpr uint64_t UNKNOWN_OFFSET = UINT64_MAX;
+
+      // Physical byte offset of the file's first extent via FIEMAP, or
+      // UNKNOWN_OFFSET when the filesystem can't tell (tmpfs, NFS, empty file)
+      static uint64_t firstPhysicalOffset(const std::string &file_path);
+
+      // Stable sort into on-disk order, grouped by device; files without a
+      // known location keep their relative order at the end. Returns how
+      // many files were mapped.
+      static size_t sortByPhysicalOffset(std::vector<std::string> &paths);
+
+      // posix_fadvise(WILLNEED) on the first window bytes of the file: start
+      // pulling its head into the page cache. Bounded so prefetching a
+      // multi-GB file does not evict everything else.
+      static void willNeed(const std::string &file_path, size_t window);
+
+      // Window the executors prefetch per file, in blocks
+      static const size_t READAHEAD_BLOCKS = 4;
+};
+
+
+#endif
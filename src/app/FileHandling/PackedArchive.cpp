@@ -0,0 +1,364 @@
+#include "PackedArchive.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char INDEX_MAGIC[8] = {'E', 'D', 'P', 'A', 'C', 'K', '0', '1'};
+
+    // <prefix>.idx: header, count fixed-size entries sorted by name, then
+    // the names back to back
+    struct IndexHeader
+    {
+        char magic[8];
+        uint64_t count;
+    };
+
+    struct IndexEntry
+    {
+        uint64_t nameOffset; // from the start of the name area
+        uint32_t nameLength;
+        uint32_t segment;
+        uint64_t offset;
+        uint64_t length;
+        uint32_t crc;
+        uint32_t reserved;
+    };
+
+    struct PendingRecord
+    {
+        std::string name;
+        PackedArchive::Member member;
+    };
+
+    bool writeAll(int fd, const char *data, size_t length) {
+        while (length > 0) {
+            ssize_t n = write(fd, data, length);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+}
+
+PackedArchive &PackedArchive::instance() {
+    static PackedArchive archive;
+    return archive;
+}
+
+PackedArchive::~PackedArchive() {
+    for (auto &segment : segmentFds) {
+        close(segment.second);
+    }
+    if (pendingFd >= 0) {
+        close(pendingFd);
+    }
+    if (index != nullptr) {
+        munmap(const_cast<char *>(index), indexSize);
+    }
+}
+
+bool PackedArchive::create(const std::string &archivePrefix, const std::string &archiveRoot, std::string &error) {
+    prefix = archivePrefix;
+    root = archiveRoot;
+    if (fs::exists(prefix + ".idx") || fs::exists(segmentPath(0))) {
+        error = "archive " + prefix + " already exists";
+        return false;
+    }
+    pendingFd = open((prefix + ".pending").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (pendingFd < 0) {
+        error = "unable to create " + prefix + ".pending";
+        return false;
+    }
+    void *page = mmap(nullptr, sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        error = "unable to map the segment cursor";
+        return false;
+    }
+    cursor = new (page) std::atomic<uint64_t>(0);
+    // Opened here so forked workers inherit the descriptor instead of
+    // each paying an open() of their own
+    if (segmentDescriptor(0) < 0) {
+        error = "unable to create " + segmentPath(0);
+        return false;
+    }
+    return true;
+}
+
+std::string PackedArchive::memberName(const std::string &filePath) const {
+    return fs::path(filePath).lexically_relative(root).generic_string();
+}
+
+PackedArchive::Member PackedArchive::reserve(uint64_t length) {
+    const uint64_t offsetMask = (1ULL << OFFSET_BITS) - 1;
+    Member member;
+    member.length = length;
+    uint64_t current = cursor->load();
+    uint64_t next;
+    do {
+        member.segment = static_cast<uint32_t>(current >> OFFSET_BITS);
+        member.offset = current & offsetMask;
+        // Members never straddle segments; one larger than a whole
+        // segment gets a segment of its own
+        if (member.offset > 0 && member.offset + length > SEGMENT_SIZE) {
+            member.segment++;
+            member.offset = 0;
+        }
+        next = (static_cast<uint64_t>(member.segment) << OFFSET_BITS) | (member.offset + length);
+    } while (!cursor->compare_exchange_weak(current, next));
+    return member;
+}
+
+ssize_t PackedArchive::writeAt(uint32_t segment, const char *data, size_t length, uint64_t offset) {
+    int fd = segmentDescriptor(segment);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pwrite(fd, data + done, length - done, offset + done);
+        if (n <= 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+bool PackedArchive::addToIndex(const std::string &name, const Member &member) {
+    char prefixFields[96];
+    snprintf(prefixFields, sizeof(prefixFields), "%u %llu %llu %08x ", member.segment,
+             static_cast<unsigned long long>(member.offset), static_cast<unsigned long long>(member.length), member.crc);
+    std::string line = prefixFields + name + "\n";
+    // One write() per record on an O_APPEND descriptor, so records from
+    // threads and forked workers never interleave
+    return write(pendingFd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+}
+
+long PackedArchive::finish(std::string &error) {
+    // Member data must be durable before an index points at it
+    for (uint32_t segment = 0; segment < segmentCount(); segment++) {
+        int fd = segmentDescriptor(segment);
+        if (fd < 0 || fdatasync(fd) != 0) {
+            error = "unable to sync " + segmentPath(segment);
+            return -1;
+        }
+    }
+
+    std::vector<PendingRecord> records;
+    std::ifstream in(prefix + ".pending");
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        PendingRecord record;
+        unsigned long long offset, length;
+        iss >> record.member.segment >> offset >> length >> std::hex >> record.member.crc >> std::dec;
+        if (!iss || !std::getline(iss >> std::ws, record.name) || record.name.empty()) {
+            continue;
+        }
+        record.member.offset = offset;
+        record.member.length = length;
+        records.push_back(std::move(record));
+    }
+    std::sort(records.begin(), records.end(), [](const PendingRecord &a, const PendingRecord &b) {
+        return a.name < b.name;
+    });
+
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.count = records.size();
+    std::vector<IndexEntry> entries;
+    std::string names;
+    entries.reserve(records.size());
+    for (const PendingRecord &record : records) {
+        IndexEntry entry{};
+        entry.nameOffset = names.size();
+        entry.nameLength = static_cast<uint32_t>(record.name.size());
+        entry.segment = record.member.segment;
+        entry.offset = record.member.offset;
+        entry.length = record.member.length;
+        entry.crc = record.member.crc;
+        entries.push_back(entry);
+        names += record.name;
+    }
+
+    // Written aside and renamed, so a reader never maps a half-written index
+    std::string temporary = prefix + ".idx.tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "unable to create " + temporary;
+        return -1;
+    }
+    bool written = writeAll(fd, reinterpret_cast<const char *>(&header), sizeof(header)) &&
+                   writeAll(fd, reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(IndexEntry)) &&
+                   writeAll(fd, names.data(), names.size()) && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(temporary.c_str(), (prefix + ".idx").c_str()) != 0) {
+        error = "unable to write " + prefix + ".idx";
+        return -1;
+    }
+    unlink((prefix + ".pending").c_str());
+    close(pendingFd);
+    pendingFd = -1;
+    return static_cast<long>(records.size());
+}
+
+uint32_t PackedArchive::segmentCount() const {
+    if (cursor == nullptr) {
+        return 0;
+    }
+    uint64_t current = cursor->load();
+    return static_cast<uint32_t>(current >> OFFSET_BITS) + (current != 0 ? 1 : 0);
+}
+
+bool PackedArchive::openForRead(const std::string &archivePrefix, const std::string &outputDir, std::string &error) {
+    prefix = archivePrefix;
+    outputDirectory = outputDir;
+    std::string path = prefix + ".idx";
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "unable to open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(IndexHeader)) {
+        close(fd);
+        error = path + " is not an archive index";
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        error = "unable to map " + path;
+        return false;
+    }
+    // Everything below trusts the index, so check it all here: a corrupt or
+    // crafted one must fail cleanly rather than read outside the mapping
+    const IndexHeader *header = static_cast<const IndexHeader *>(data);
+    const IndexEntry *entries = reinterpret_cast<const IndexEntry *>(static_cast<const char *>(data) + sizeof(IndexHeader));
+    size_t entryArea = static_cast<size_t>(st.st_size) - sizeof(IndexHeader);
+    bool valid = memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                 header->count <= entryArea / sizeof(IndexEntry);
+    uint32_t segments = 0;
+    if (valid) {
+        uint64_t nameArea = entryArea - header->count * sizeof(IndexEntry);
+        for (size_t i = 0; i < header->count && valid; i++) {
+            valid = entries[i].nameOffset <= nameArea && entries[i].nameLength <= nameArea - entries[i].nameOffset &&
+                    entries[i].segment < MAX_SEGMENTS;
+            segments = std::max(segments, entries[i].segment + 1);
+        }
+    }
+    if (!valid) {
+        munmap(data, st.st_size);
+        error = path + " is not an archive index";
+        return false;
+    }
+    index = static_cast<const char *>(data);
+    indexSize = st.st_size;
+
+    // Open every segment up front, for the same reason as in create()
+    for (uint32_t segment = 0; segment < segments; segment++) {
+        if (segmentDescriptor(segment) < 0) {
+            error = "unable to open " + segmentPath(segment);
+            munmap(data, st.st_size);
+            index = nullptr;
+            indexSize = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t PackedArchive::memberCount() const {
+    return reinterpret_cast<const IndexHeader *>(index)->count;
+}
+
+std::string PackedArchive::memberNameAt(size_t position) const {
+    const IndexEntry *entries = reinterpret_cast<const IndexEntry *>(index + sizeof(IndexHeader));
+    const char *names = index + sizeof(IndexHeader) + memberCount() * sizeof(IndexEntry);
+    return std::string(names + entries[position].nameOffset, entries[position].nameLength);
+}
+
+bool PackedArchive::lookup(const std::string &name, Member &member) const {
+    const IndexEntry *entries = reinterpret_cast<const IndexEntry *>(index + sizeof(IndexHeader));
+    const IndexEntry *end = entries + memberCount();
+    const char *names = reinterpret_cast<const char *>(end);
+    auto nameOf = [names](const IndexEntry &entry) {
+        return std::string_view(names + entry.nameOffset, entry.nameLength);
+    };
+    const IndexEntry *found = std::lower_bound(entries, end, std::string_view(name),
+                                               [&nameOf](const IndexEntry &entry, std::string_view key) {
+                                                   return nameOf(entry) < key;
+                                               });
+    if (found == end || nameOf(*found) != name) {
+        return false;
+    }
+    member.segment = found->segment;
+    member.offset = found->offset;
+    member.length = found->length;
+    member.crc = found->crc;
+    return true;
+}
+
+std::string PackedArchive::outputPath(const std::string &name) const {
+    fs::path relative = fs::path(name).lexically_normal();
+    // A crafted index must not write outside the output directory
+    if (relative.is_absolute() || relative.empty() || *relative.begin() == "..") {
+        return std::string();
+    }
+    return (fs::path(outputDirectory) / relative).string();
+}
+
+ssize_t PackedArchive::readAt(uint32_t segment, char *data, size_t length, uint64_t offset) {
+    int fd = segmentDescriptor(segment);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, data + done, length - done, offset + done);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+std::string PackedArchive::segmentPath(uint32_t segment) const {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%04u.seg", segment);
+    return prefix + suffix;
+}
+
+int PackedArchive::segmentDescriptor(uint32_t segment) {
+    std::lock_guard<std::mutex> lock(segmentLock);
+    auto it = segmentFds.find(segment);
+    if (it != segmentFds.end()) {
+        return it->second;
+    }
+    int flags = isWriting() ? (O_RDWR | O_CREAT) : O_RDONLY;
+    int fd = open(segmentPath(segment).c_str(), flags | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        segmentFds[segment] = fd;
+    }
+    return fd;
+}
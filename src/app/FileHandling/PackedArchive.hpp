@@ -0,0 +1,90 @@
+#ifndef PACKED_ARCHIVE_HPP
+#define PACKED_ARCHIVE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+// Output mode for trees of many small files: encrypted contents are
+// streamed into a few large segment files instead of being rewritten in
+// place, which trades one create/write/close per file for one pwrite.
+//
+//   <prefix>.NNNN.seg  member contents back to back, at most SEGMENT_SIZE
+//                      each unless a single member is larger
+//   <prefix>.pending   unsorted "segment offset length crc name" lines,
+//                      appended by workers while packing
+//   <prefix>.idx       the same records sorted by name, written once at
+//                      the end and mmap'd by readers for binary search
+class PackedArchive
+{
+public:
+     struct Member
+     {
+          uint32_t segment = 0;
+          uint64_t offset = 0;
+          uint64_t length = 0;
+          uint32_t crc = 0; // CRC32C of the original (decrypted) contents
+     };
+
+     static constexpr uint64_t SEGMENT_SIZE = 1ULL << 30;
+     // Upper bound on segment numbers accepted from an index (64 TiB of
+     // members); every segment is opened when the archive is read
+     static constexpr uint32_t MAX_SEGMENTS = 1u << 16;
+
+     static PackedArchive &instance();
+
+     // Start a new archive for the files under root. Must run before
+     // workers start (and before any fork). Refuses to overwrite.
+     bool create(const std::string &prefix, const std::string &root, std::string &error);
+     // Map the index of a finished archive; members extract under outputDirectory
+     bool openForRead(const std::string &prefix, const std::string &outputDirectory, std::string &error);
+
+     bool isWriting() const { return pendingFd >= 0; }
+     bool isReading() const { return index != nullptr; }
+
+     // Packing, callable from any thread or forked worker
+     std::string memberName(const std::string &filePath) const;
+     Member reserve(uint64_t length);
+     ssize_t writeAt(uint32_t segment, const char *data, size_t length, uint64_t offset);
+     bool addToIndex(const std::string &name, const Member &member);
+
+     // Sort the pending records into <prefix>.idx. Returns the member count, -1 on error
+     long finish(std::string &error);
+     uint32_t segmentCount() const;
+
+     // Reading
+     size_t memberCount() const;
+     std::string memberNameAt(size_t position) const;
+     bool lookup(const std::string &name, Member &member) const;
+     std::string outputPath(const std::string &name) const;
+     ssize_t readAt(uint32_t segment, char *data, size_t length, uint64_t offset);
+
+private:
+     PackedArchive() = default;
+     ~PackedArchive();
+
+     std::string segmentPath(uint32_t segment) const;
+     int segmentDescriptor(uint32_t segment);
+
+     std::string prefix;
+     std::string root;
+     std::string outputDirectory;
+     int pendingFd = -1;
+
+     // Next free byte as (segment << OFFSET_BITS) | offset, MAP_SHARED so
+     // forked workers reserve from the same cursor
+     static constexpr int OFFSET_BITS = 40;
+     std::atomic<uint64_t> *cursor = nullptr;
+
+     std::mutex segmentLock;
+     std::map<uint32_t, int> segmentFds;
+
+     const char *index = nullptr; // mmap of <prefix>.idx
+     size_t indexSize = 0;
+};
+
+#endif
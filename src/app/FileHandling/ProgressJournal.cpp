@@ -0,0 +1,202 @@
+#include "ProgressJournal.hpp"
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ProgressJournal &ProgressJournal::instance() {
+    static ProgressJournal journal;
+    return journal;
+}
+
+ProgressJournal::ProgressJournal() : shared(&localStats) {}
+
+ProgressJournal::~ProgressJournal() {
+    // No sync here: forked workers exit() through this, and syncing per
+    // worker would undo the batching. The front end calls sync() instead.
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool ProgressJournal::open(const std::string &path, const std::string &action, size_t blockSize,
+                           bool resume, std::string &error) {
+    struct stat st;
+    bool existing = stat(path.c_str(), &st) == 0 && st.st_size > 0;
+    if (existing && !resume) {
+        error = "journal " + path + " already has entries; pass --resume to continue that run or remove it";
+        return false;
+    }
+    if (existing && !load(path, action, blockSize, error)) {
+        return false;
+    }
+
+    void *page = mmap(nullptr, sizeof(Stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (page != MAP_FAILED) {
+        shared = new (page) Stats();
+    }
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "unable to open journal " + path;
+        return false;
+    }
+    size_t sequence;
+    if (!existing && !append("J " + action + " " + std::to_string(blockSize) + "\n", 1, sequence)) {
+        error = "unable to write journal " + path;
+        return false;
+    }
+
+    return true;
+}
+
+bool ProgressJournal::load(const std::string &path, const std::string &action, size_t blockSize,
+                           std::string &error) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) {
+        error = "unable to read journal " + path;
+        return false;
+    }
+    std::istringstream header(line);
+    std::string tag, journalAction;
+    size_t journalBlockSize = 0;
+    header >> tag >> journalAction >> journalBlockSize;
+    if (tag != "J") {
+        error = path + " is not a progress journal";
+        return false;
+    }
+    if (journalAction != action) {
+        error = "journal " + path + " was written by a " + journalAction + " run";
+        return false;
+    }
+    if (journalBlockSize != blockSize) {
+        // Chunk records only line up with the block size that wrote them
+        error = "journal " + path + " was written with --block-size " + std::to_string(journalBlockSize / 1024);
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string filePath;
+        iss >> tag;
+        if (tag == "C") {
+            Chunk chunk;
+            unsigned long long offset, length;
+            iss >> offset >> length >> std::hex >> chunk.crcIn >> chunk.crcOut >> std::dec;
+            if (!iss || !std::getline(iss >> std::ws, filePath) || filePath.empty()) {
+                continue; // torn last line from an interrupted run
+            }
+            chunk.offset = offset;
+            chunk.length = length;
+            previous[filePath].chunks[chunk.offset] = chunk;
+        } else if (tag == "F" || tag == "R") {
+            uint32_t crcIn, crcOut;
+            unsigned long long bytes;
+            iss >> std::hex >> crcIn >> crcOut >> std::dec >> bytes;
+            if (!iss || !std::getline(iss >> std::ws, filePath) || filePath.empty()) {
+                continue;
+            }
+            FileProgress &progress = previous[filePath];
+            if (tag == "F") {
+                progress.complete = true;
+            } else {
+                progress.replacing = true;
+                progress.replaceCrcIn = crcIn;
+                progress.replaceCrcOut = crcOut;
+                progress.replaceBytes = bytes;
+            }
+        }
+    }
+    return true;
+}
+
+const ProgressJournal::FileProgress *ProgressJournal::recovered(const std::string &filePath) const {
+    auto it = previous.find(filePath);
+    return it == previous.end() ? nullptr : &it->second;
+}
+
+size_t ProgressJournal::recoveredComplete() const {
+    size_t count = 0;
+    for (const auto &entry : previous) {
+        count += entry.second.complete ? 1 : 0;
+    }
+    return count;
+}
+
+size_t ProgressJournal::recoveredPartial() const {
+    return previous.size() - recoveredComplete();
+}
+
+bool ProgressJournal::recordChunks(const std::string &filePath, const std::vector<Chunk> &chunks, size_t &sequence) {
+    std::string lines;
+    for (const Chunk &chunk : chunks) {
+        char prefix[96];
+        snprintf(prefix, sizeof(prefix), "C %llu %llu %08x %08x ", static_cast<unsigned long long>(chunk.offset),
+                 static_cast<unsigned long long>(chunk.length), chunk.crcIn, chunk.crcOut);
+        lines += prefix + filePath + "\n";
+    }
+    return chunks.empty() || append(lines, chunks.size(), sequence);
+}
+
+bool ProgressJournal::recordFile(const std::string &filePath, uint32_t crcIn, uint32_t crcOut, uint64_t bytes) {
+    size_t sequence;
+    return append(fileLine('F', filePath, crcIn, crcOut, bytes), 1, sequence);
+}
+
+bool ProgressJournal::recordReplace(const std::string &filePath, uint32_t crcIn, uint32_t crcOut, uint64_t bytes) {
+    size_t sequence;
+    if (!append(fileLine('R', filePath, crcIn, crcOut, bytes), 1, sequence)) {
+        return false;
+    }
+    makeDurable(sequence);
+    return true;
+}
+
+std::string ProgressJournal::fileLine(char tag, const std::string &filePath, uint32_t crcIn, uint32_t crcOut,
+                                      uint64_t bytes) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%c %08x %08x %llu ", tag, crcIn, crcOut, static_cast<unsigned long long>(bytes));
+    return prefix + filePath + "\n";
+}
+
+bool ProgressJournal::append(const std::string &lines, size_t count, size_t &sequence) {
+    // One write() per batch of lines on an O_APPEND descriptor keeps lines
+    // from threads and forked workers whole
+    if (write(fd, lines.data(), lines.size()) != static_cast<ssize_t>(lines.size())) {
+        return false;
+    }
+    // Counted only after the write, so every line up to a given count is
+    // already in the file when that count is read
+    size_t records = shared->records.fetch_add(count) + count;
+    sequence = records;
+    // Whoever crosses the batch boundary syncs for everyone behind it
+    if (records - shared->syncedRecords.load() >= SYNC_BATCH) {
+        makeDurable(records);
+    }
+    return true;
+}
+
+void ProgressJournal::makeDurable(size_t sequence) {
+    if (shared->syncedRecords.load() >= sequence) {
+        return; // a sync that started after our write covered it
+    }
+    // syncedRecords only moves once the data is on disk, so nobody skips
+    // their own sync on the strength of one still in progress
+    size_t covered = shared->records.load();
+    fdatasync(fd);
+    shared->syncs.fetch_add(1);
+    size_t synced = shared->syncedRecords.load();
+    while (synced < covered && !shared->syncedRecords.compare_exchange_weak(synced, covered)) {
+    }
+}
+
+void ProgressJournal::sync() {
+    if (fd < 0) {
+        return;
+    }
+    makeDurable(shared->records.load());
+}
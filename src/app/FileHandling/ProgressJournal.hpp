@@ -0,0 +1,114 @@
+#ifndef PROGRESS_JOURNAL_HPP
+#define PROGRESS_JOURNAL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Append-only record of how far an in-place run got, so an interrupted run
+// can be resumed instead of restored from backup. One line per event:
+//
+//   J <action> <block size>                       header, first line
+//   C <offset> <length> <crc_in> <crc_out> <path> chunk about to be written
+//   R <crc_in> <crc_out> <bytes> <path>           replacement about to be
+//                                                 renamed over the file
+//   F <crc_in> <crc_out> <bytes> <path>           file finished
+//
+// A C line is on disk before its chunk is written back, so after a crash
+// (of the process or of the machine) every chunk that may have changed
+// has one. Its two checksums tell on resume whether the chunk still holds
+// the original bytes (redo it) or the transformed ones (skip it). A worker
+// journals a window of chunks ahead and makes them durable together, and
+// the fdatasync is a group commit: one call covers the lines every worker
+// has appended so far. F lines are only synced in batches; losing one just
+// means the file's chunks are checked again on resume.
+//
+// Framed output (--compress, ChaCha20) is written beside the file and
+// renamed over it, so no C lines are needed, but a crash between the
+// rename and the F line would leave an output that resume cannot tell
+// from an input. The R line is durable before the rename; on resume a
+// file whose contents match its crc_out and bytes was already replaced.
+class ProgressJournal
+{
+public:
+     struct Chunk
+     {
+          uint64_t offset = 0;
+          uint64_t length = 0;
+          uint32_t crcIn = 0;
+          uint32_t crcOut = 0;
+     };
+
+     struct FileProgress
+     {
+          bool complete = false;
+          std::map<uint64_t, Chunk> chunks; // by offset
+          // Set by an R line: what the file holds if the rename happened
+          bool replacing = false;
+          uint32_t replaceCrcIn = 0;
+          uint32_t replaceCrcOut = 0;
+          uint64_t replaceBytes = 0;
+     };
+
+     struct Stats
+     {
+          std::atomic<size_t> records{0};
+          std::atomic<size_t> syncs{0};
+          std::atomic<size_t> syncedRecords{0};
+     };
+
+     static constexpr size_t SYNC_BATCH = 64;
+     // Data a worker journals ahead of writing it back, budget permitting:
+     // one fdatasync per window instead of one per block
+     static constexpr size_t WINDOW_BYTES = 8 << 20;
+
+     static ProgressJournal &instance();
+
+     // Must run before workers start (and before any fork). Refuses an
+     // existing journal unless resuming, and a journal written for another
+     // action or block size. Returns false with the reason in error.
+     bool open(const std::string &path, const std::string &action, size_t blockSize,
+               bool resume, std::string &error);
+
+     bool isOpen() const { return fd >= 0; }
+
+     // What an earlier run recorded for this file, nullptr if nothing
+     const FileProgress *recovered(const std::string &filePath) const;
+     size_t recoveredComplete() const;
+     size_t recoveredPartial() const;
+
+     // One C line per chunk, in a single write. sequence receives the last
+     // line's number; the chunks may be written once makeDurable() covers it
+     bool recordChunks(const std::string &filePath, const std::vector<Chunk> &chunks, size_t &sequence);
+     bool recordFile(const std::string &filePath, uint32_t crcIn, uint32_t crcOut, uint64_t bytes);
+     // Returns once the line is durable, so the replacement may be renamed
+     bool recordReplace(const std::string &filePath, uint32_t crcIn, uint32_t crcOut, uint64_t bytes);
+
+     // Returns once every line up to this sequence number is on disk
+     void makeDurable(size_t sequence);
+     // Make every line appended so far durable (end of run)
+     void sync();
+
+     const Stats &stats() const { return *shared; }
+
+private:
+     ProgressJournal();
+     ~ProgressJournal();
+
+     bool load(const std::string &path, const std::string &action, size_t blockSize, std::string &error);
+     // count lines in one write; sequence receives the last one's number
+     bool append(const std::string &lines, size_t count, size_t &sequence);
+     static std::string fileLine(char tag, const std::string &filePath, uint32_t crcIn, uint32_t crcOut, uint64_t bytes);
+
+     int fd = -1;
+     std::unordered_map<std::string, FileProgress> previous;
+
+     Stats localStats;
+     Stats *shared; // MAP_SHARED once opened, so forked workers batch syncs together
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "ConcurrencyController.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    // Relative change in MB/s we treat as a real move rather than noise
+    const double SIGNIFICANT_CHANGE = 0.10;
+    // Fraction of CPU time stuck in iowait above which the disk is saturated
+    const double IOWAIT_SATURATED = 0.40;
+}
+
+ConcurrencyController::ConcurrencyController(int minWorkers, int maxWorkers,
+                                             std::function<ControllerSample()> sampler,
+                                             std::chrono::milliseconds interval)
+    : minLimit(std::max(1, minWorkers)),
+      maxLimit(std::max(std::max(1, minWorkers), maxWorkers)),
+      sampler(std::move(sampler)),
+      interval(interval) {
+    int cores = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    limit.store(std::clamp(cores, minLimit, maxLimit));
+}
+
+ConcurrencyController::~ConcurrencyController() {
+    stop();
+}
+
+void ConcurrencyController::start() {
+    if (worker.joinable()) {
+        return;
+    }
+    lastBytes = sampler().bytesCompleted;
+    readCpuTimes(lastIowait, lastTotal);
+    std::cout << "[CONTROLLER] starting with " << limit.load() << " workers (bounds "
+              << minLimit << "-" << maxLimit << ")" << std::endl;
+    if (minLimit == maxLimit) {
+        return; // nothing to tune
+    }
+    worker = std::thread(&ConcurrencyController::run, this);
+}
+
+void ConcurrencyController::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopLock);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void ConcurrencyController::run() {
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(stopLock);
+    while (!stopSignal.wait_for(lock, interval, [this] { return stopping; })) {
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        last = now;
+        lock.unlock();
+        tick(seconds);
+        lock.lock();
+    }
+}
+
+void ConcurrencyController::tick(double seconds) {
+    ControllerSample sample = sampler();
+    size_t delta = sample.bytesCompleted - lastBytes;
+    lastBytes = sample.bytesCompleted;
+    double rawMbps = seconds > 0 ? (delta / (1024.0 * 1024.0)) / seconds : 0.0;
+    // Smooth out per-tick noise from files completing in bursts
+    double mbps = lastMbps > 0 ? 0.5 * rawMbps + 0.5 * lastMbps : rawMbps;
+
+    double iowait = 0.0;
+    unsigned long long io = 0, total = 0;
+    if (readCpuTimes(io, total) && total > lastTotal) {
+        iowait = double(io - lastIowait) / double(total - lastTotal);
+    }
+    lastIowait = io;
+    lastTotal = total;
+
+    int current = limit.load();
+    int step = std::max(1, current / 4);
+    double previous = lastMbps;
+    lastMbps = mbps;
+
+    if (sample.queueDepth == 0 || (mbps == 0.0 && previous == 0.0)) {
+        return; // no backlog or nothing finished yet: no signal to act on
+    }
+
+    if (iowait > IOWAIT_SATURATED && mbps <= previous * (1.0 + SIGNIFICANT_CHANGE)) {
+        direction = -1;
+        moveTo(current - step, mbps, sample.queueDepth, iowait, "disk saturated");
+    } else if (mbps > previous * (1.0 + SIGNIFICANT_CHANGE)) {
+        moveTo(current + direction * step, mbps, sample.queueDepth, iowait, "throughput rising");
+    } else if (mbps < previous * (1.0 - SIGNIFICANT_CHANGE)) {
+        direction = -direction;
+        moveTo(current + direction * step, mbps, sample.queueDepth, iowait, "throughput fell, reversing");
+    }
+}
+
+void ConcurrencyController::moveTo(int target, double mbps, size_t depth, double iowait, const char *reason) {
+    int current = limit.load();
+    target = std::clamp(target, minLimit, maxLimit);
+    if (target == current) {
+        // Pinned at a bound: probe the other way next time
+        direction = (current == maxLimit) ? -1 : 1;
+        return;
+    }
+    limit.store(target);
+
+    std::ostringstream oss;
+    oss << "[CONTROLLER] workers " << current << " -> " << target
+        << " (" << std::fixed << std::setprecision(2) << mbps << " MB/s, queue " << depth
+        << ", iowait " << std::setprecision(1) << iowait * 100.0 << "%): " << reason;
+    std::cout << oss.str() << std::endl;
+
+    if (onChange) {
+        onChange(target);
+    }
+}
+
+bool ConcurrencyController::readCpuTimes(unsigned long long &iowait, unsigned long long &total) {
+    std::ifstream stat("/proc/stat");
+    std::string cpu;
+    unsigned long long user, nice, system, idle, io, irq, softirq, steal;
+    if (!(stat >> cpu >> user >> nice >> system >> idle >> io >> irq >> softirq >> steal) || cpu != "cpu") {
+        return false;
+    }
+    iowait = io;
+    total = user + nice + system + idle + io + irq + softirq + steal;
+    return true;
+}
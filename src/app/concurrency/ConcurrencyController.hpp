@@ -0,0 +1,74 @@
+#ifndef CONCURRENCY_CONTROLLER_HPP
+#define CONCURRENCY_CONTROLLER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// What the executor reports to the controller on every tick.
+struct ControllerSample
+{
+     size_t bytesCompleted; // monotonic, taken from the benchmark counters
+     size_t queueDepth;     // tasks waiting for a free worker
+};
+
+// Hill-climbing feedback loop that keeps the number of active workers
+// between minWorkers and maxWorkers, moving in whichever direction last
+// raised MB/s and backing off when the disk is saturated (high iowait).
+class ConcurrencyController
+{
+public:
+     ConcurrencyController(int minWorkers, int maxWorkers,
+                           std::function<ControllerSample()> sampler,
+                           std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+     ~ConcurrencyController();
+
+     void start();
+     void stop();
+
+     int activeLimit() const { return limit.load(); }
+     int minWorkers() const { return minLimit; }
+     int maxWorkers() const { return maxLimit; }
+
+     // Called whenever the limit changes so the executor can wake workers.
+     void setOnChange(std::function<void(int)> callback) { onChange = std::move(callback); }
+
+     static int defaultMaxWorkers()
+     {
+          int cores = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+          return cores * 4 > 4 ? cores * 4 : 4;
+     }
+
+private:
+     void run();
+     void tick(double seconds);
+     void moveTo(int target, double mbps, size_t depth, double iowait, const char *reason);
+     static bool readCpuTimes(unsigned long long &iowait, unsigned long long &total);
+
+     const int minLimit;
+     const int maxLimit;
+     std::atomic<int> limit;
+     std::function<ControllerSample()> sampler;
+     std::function<void(int)> onChange;
+     std::chrono::milliseconds interval;
+
+     std::thread worker;
+     std::mutex stopLock;
+     std::condition_variable stopSignal;
+     bool stopping = false;
+
+     // State carried between ticks
+     size_t lastBytes = 0;
+     unsigned long long lastIowait = 0;
+     unsigned long long lastTotal = 0;
+     double lastMbps = 0.0;
+     int direction = 1;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "FairShare.hpp"
+#include <algorithm>
+
+void FairShare::setWeight(int flow, unsigned weight) {
+    Flow &state = flows[flow];
+    state.weight = std::max(1u, weight);
+    state.idle = false;
+}
+
+double FairShare::startTag(int flow) const {
+    auto it = flows.find(flow);
+    return it == flows.end() ? virtualTime : std::max(virtualTime, it->second.finishTag);
+}
+
+void FairShare::charge(int flow, size_t cost) {
+    double start = startTag(flow);
+    Flow &state = flows[flow];
+    // Virtual time follows the start tag of the task in service
+    virtualTime = start;
+    state.finishTag = start + static_cast<double>(cost) / state.weight;
+
+    for (auto it = flows.begin(); it != flows.end();) {
+        if (it->second.idle && it->second.finishTag <= virtualTime) {
+            it = flows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FairShare::release(int flow) {
+    auto it = flows.find(flow);
+    if (it == flows.end()) {
+        return;
+    }
+    if (it->second.finishTag <= virtualTime) {
+        flows.erase(it);
+    } else {
+        it->second.idle = true;
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> FairShare::order(const std::vector<std::vector<size_t>> &costs,
+                                                        const std::vector<unsigned> &weights) {
+    FairShare share;
+    size_t total = 0;
+    for (size_t flow = 0; flow < costs.size(); flow++) {
+        share.setWeight(static_cast<int>(flow), flow < weights.size() ? weights[flow] : 1);
+        total += costs[flow].size();
+    }
+
+    std::vector<size_t> next(costs.size(), 0);
+    std::vector<std::pair<size_t, size_t>> merged;
+    merged.reserve(total);
+    while (merged.size() < total) {
+        // Smallest start tag wins; ties go to the lower flow index
+        size_t best = costs.size();
+        for (size_t flow = 0; flow < costs.size(); flow++) {
+            if (next[flow] < costs[flow].size() &&
+                (best == costs.size() || share.startTag(static_cast<int>(flow)) < share.startTag(static_cast<int>(best)))) {
+                best = flow;
+            }
+        }
+        share.charge(static_cast<int>(best), costs[best][next[best]]);
+        merged.emplace_back(best, next[best]++);
+    }
+    return merged;
+}
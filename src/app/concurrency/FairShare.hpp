@@ -0,0 +1,58 @@
+#ifndef FAIR_SHARE_HPP
+#define FAIR_SHARE_HPP
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Weighted fair queueing over flows (input roots, daemon jobs), using
+// start-time fair queueing tags. Each served task advances its flow's
+// finish tag by cost / weight; the backlogged flow with the smallest start
+// tag goes next. A flow that was idle starts at the current virtual time,
+// so it gets its share from then on but no credit for the time it waited.
+//
+// Costs are bytes plus PER_TASK_COST, so a flow of small files is not
+// charged as if opening a file were free.
+class FairShare
+{
+public:
+     // Fixed cost per task on top of its bytes: open, fsync, bookkeeping
+     static const size_t PER_TASK_COST = 64 * 1024;
+
+     static size_t taskCost(size_t bytes) { return bytes + PER_TASK_COST; }
+
+     // Weights below 1 are treated as 1
+     void setWeight(int flow, unsigned weight);
+
+     // The tag the flow's next task would start at
+     double startTag(int flow) const;
+
+     // Account for serving a task of this cost from the flow
+     void charge(int flow, size_t cost);
+
+     // The flow has nothing queued. Its finish tag is kept until virtual
+     // time passes it, so emptying a queue for a moment earns no credit;
+     // after that the state is dropped. setWeight() makes it active again.
+     void release(int flow);
+
+     // Merge per-flow task costs into a single order, as (flow, index)
+     // pairs: the order this scheduler would serve them in if every flow
+     // were backlogged from the start. Used where the executor itself has
+     // one FIFO, so the fairness has to be in the submission order.
+     static std::vector<std::pair<size_t, size_t>> order(const std::vector<std::vector<size_t>> &costs,
+                                                         const std::vector<unsigned> &weights);
+
+private:
+     struct Flow
+     {
+          unsigned weight = 1;
+          double finishTag = 0;
+          bool idle = false;
+     };
+
+     std::map<int, Flow> flows;
+     double virtualTime = 0;
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "JobServer.hpp"
+#include "BenchmarkLogger2.hpp"
+#include "RunOptions.hpp"
+#include "../encryptDecrypt/Compression.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Progress of one client's job, shared with the completion callbacks.
+    // Callbacks run on pool workers shared by every job, so they only queue
+    // status lines; the client's own handler thread writes them out, and a
+    // slow client stalls nobody but itself.
+    struct JobState
+    {
+        std::mutex lock;
+        std::condition_variable done;
+        size_t submitted = 0;
+        size_t succeeded = 0;
+        size_t failed = 0;
+        std::deque<std::string> lines;
+
+        bool finished() const { return succeeded + failed == submitted; }
+    };
+}
+
+JobServer::JobServer(const std::string &socketPath, ThreadManagement &executor)
+    : socketPath(socketPath), executor(executor) {}
+
+JobServer::~JobServer() {
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool JobServer::start() {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        std::cerr << "socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    // A stale socket file from a crashed daemon would make bind fail
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listenFd, 64) != 0) {
+        std::cerr << "Unable to listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    std::cout << "[DAEMON] listening on " << socketPath << std::endl;
+    return true;
+}
+
+void JobServer::serve() {
+    while (!stopping.load()) {
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (!stopping.load()) {
+                std::cerr << "accept: " << strerror(errno) << std::endl;
+            }
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(activeLock);
+            activeJobs++;
+        }
+        std::thread(&JobServer::handleClient, this, clientFd).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(activeLock);
+    activeDone.wait(lock, [this] { return activeJobs == 0; });
+    std::cout << "[DAEMON] stopped" << std::endl;
+}
+
+void JobServer::stop() {
+    stopping.store(true);
+    if (listenFd >= 0) {
+        shutdown(listenFd, SHUT_RDWR);
+    }
+}
+
+void JobServer::handleClient(int clientFd) {
+    std::string request;
+    std::string action;
+    std::string directory;
+    int jobId = 0;
+    JobOptions options;
+    unsigned weight = 1;
+    if (readLine(clientFd, request)) {
+        std::istringstream iss(request);
+        iss >> action;
+        // Flags come between the action and the directory, which may contain spaces
+        while (iss >> std::ws && iss.peek() == '-') {
+            std::string flag;
+            iss >> flag;
+            if (flag == "--direct-io") {
+                options.directIO = true;
+            } else if (flag == "--skip-holes") {
+                options.skipHoles = true;
+            } else if (flag == "--compress") {
+                options.compress = true;
+            } else if (flag == "--cipher") {
+                std::string cipher;
+                if (!(iss >> cipher) || !cipherFromString(cipher, options.cipher)) {
+                    action.clear();
+                    break;
+                }
+            } else if (flag != "--weight" || !(iss >> weight) || weight == 0) {
+                action.clear(); // answered as a malformed request below
+                break;
+            }
+        }
+        std::getline(iss, directory);
+    }
+
+    if (action != "encrypt" && action != "decrypt") {
+        sendLine(clientFd, "ERROR expected \"encrypt <directory>\" or \"decrypt <directory>\"");
+    } else if (options.compress && options.cipher != CipherKind::Shift) {
+        sendLine(clientFd, "ERROR --compress only works with the shift cipher");
+    } else if (!fs::is_directory(directory)) {
+        sendLine(clientFd, "ERROR invalid directory: " + directory);
+    } else if (!claimRoot(directory, jobId)) {
+        sendLine(clientFd, "ERROR directory overlaps a running job: " + directory);
+    } else {
+        Action taskAction = (action == "encrypt") ? Action::ENCRYPT : Action::DECRYPT;
+        auto state = std::make_shared<JobState>();
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        sendLine(clientFd, "ACCEPTED " + std::to_string(jobId));
+        std::cout << "[DAEMON] job " << jobId << ": " << action << " " << directory << " (weight " << weight << ")" << std::endl;
+
+        try {
+            for (const auto &entry : fs::recursive_directory_iterator(directory)) {
+                // Leftovers of an interrupted --compress run are not inputs
+                if (!entry.is_regular_file() || entry.path().extension() == Frame::TEMPORARY_SUFFIX) {
+                    continue;
+                }
+                std::string filePath = entry.path().string();
+                std::error_code ec;
+                bytes += entry.file_size(ec);
+                {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    state->submitted++;
+                }
+                auto task = std::make_unique<Task>(std::fstream(), taskAction, filePath);
+                task->options = options;
+                bool queued = executor.SubmitToQueue(std::move(task), jobId, [state, filePath](int result) {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    if (result == 0) {
+                        state->succeeded++;
+                    } else {
+                        state->failed++;
+                    }
+                    state->lines.push_back((result == 0 ? "OK " : "FAILED ") + filePath);
+                    state->done.notify_all();
+                }, weight);
+                if (!queued) {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    state->submitted--;
+                    break;
+                }
+                BenchmarkLogger2::record_file_operation(filePath, true);
+            }
+        } catch (const fs::filesystem_error &e) {
+            sendLine(clientFd, std::string("ERROR filesystem: ") + e.what());
+        }
+
+        // Forward status lines as they arrive; the socket is written
+        // without the lock, so callbacks never wait on the client
+        std::unique_lock<std::mutex> lock(state->lock);
+        bool finished = false;
+        while (!finished) {
+            state->done.wait(lock, [&state] { return !state->lines.empty() || state->finished(); });
+            std::deque<std::string> pending;
+            pending.swap(state->lines);
+            finished = state->finished();
+            lock.unlock();
+            for (const auto &line : pending) {
+                sendLine(clientFd, line);
+            }
+            lock.lock();
+        }
+        releaseRoot(jobId);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::ostringstream done;
+        done << "DONE job=" << jobId << " files=" << state->submitted << " failed=" << state->failed
+             << " bytes=" << bytes << std::fixed << std::setprecision(6) << " seconds=" << seconds
+             << std::setprecision(2) << " mb_per_sec=" << (seconds > 0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0);
+        sendLine(clientFd, done.str());
+        std::cout << "[DAEMON] " << done.str() << std::endl;
+    }
+
+    close(clientFd);
+    std::lock_guard<std::mutex> lock(activeLock);
+    activeJobs--;
+    activeDone.notify_all();
+}
+
+bool JobServer::claimRoot(const std::string &directory, int &jobId) {
+    fs::path root = RunOptions::canonicalRoot(directory);
+    std::lock_guard<std::mutex> lock(activeLock);
+    for (const auto &active : activeRoots) {
+        if (RunOptions::rootContains(active.second, root) || RunOptions::rootContains(root, active.second)) {
+            return false;
+        }
+    }
+    jobId = nextJobId.fetch_add(1);
+    activeRoots[jobId] = root;
+    return true;
+}
+
+void JobServer::releaseRoot(int jobId) {
+    std::lock_guard<std::mutex> lock(activeLock);
+    activeRoots.erase(jobId);
+}
+
+bool JobServer::readLine(int fd, std::string &line) {
+    line.clear();
+    char ch;
+    while (line.size() < 4096) {
+        ssize_t n = recv(fd, &ch, 1, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return !line.empty();
+        }
+        if (ch == '\n') {
+            return true;
+        }
+        line.push_back(ch);
+    }
+    return true;
+}
+
+bool JobServer::sendLine(int fd, const std::string &line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        // MSG_NOSIGNAL: a client that hung up must not kill the daemon with SIGPIPE
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef JOB_SERVER_HPP
+#define JOB_SERVER_HPP
+
+#include "../threads/ThreadManagement.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Accepts encrypt/decrypt jobs on a UNIX domain socket and runs them on a
+// shared, already warm ThreadManagement pool.
+//
+// Protocol (one line each way, '\n' terminated):
+//   client -> "encrypt <directory>" or "decrypt <directory>", optionally
+//             with flags before the directory: "--direct-io" to bypass the
+//             page cache, "--skip-holes", "--compress" and "--cipher <name>"
+//             as on the command line, "--weight <n>" for n times the
+//             default share of the workers while other jobs are queued
+//   server -> "ACCEPTED <job id>"
+//             "OK <path>" / "FAILED <path>" as each file finishes
+//             "DONE job=<id> files=<n> failed=<n> bytes=<n> seconds=<s> mb_per_sec=<r>"
+//             or "ERROR <reason>", e.g. when the directory is, contains or
+//             lies inside that of a job still running
+class JobServer
+{
+public:
+     JobServer(const std::string &socketPath, ThreadManagement &executor);
+     ~JobServer();
+
+     bool start();
+     // Accept loop; returns after stop() once in-flight jobs have finished
+     void serve();
+     // Async-signal-safe, so it can be called from a SIGTERM handler
+     void stop();
+
+private:
+     void handleClient(int clientFd);
+     // Registers the job's directory unless it overlaps a running job's
+     bool claimRoot(const std::string &directory, int &jobId);
+     void releaseRoot(int jobId);
+     static bool readLine(int fd, std::string &line);
+     static bool sendLine(int fd, const std::string &line);
+
+     std::string socketPath;
+     ThreadManagement &executor;
+     int listenFd = -1;
+     std::atomic<bool> stopping{false};
+     std::atomic<int> nextJobId{1};
+
+     std::mutex activeLock;
+     std::condition_variable activeDone;
+     int activeJobs = 0;
+     // Canonical directory of every running job, by job id; a job that
+     // overlaps one of them is refused, so no file is transformed twice
+     std::map<int, std::filesystem::path> activeRoots;
+};
+
+#endif
@@ -0,0 +1,358 @@
+#include "ChaCha20.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHACHA20_HAVE_X86 1
+#endif
+
+namespace {
+    const uint32_t SIGMA[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574}; // "expand 32-byte k"
+    const size_t BLOCK = 64;
+
+    inline uint32_t rotateLeft(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    inline void quarterRound(uint32_t x[16], int a, int b, int c, int d)
+    {
+        x[a] += x[b]; x[d] = rotateLeft(x[d] ^ x[a], 16);
+        x[c] += x[d]; x[b] = rotateLeft(x[b] ^ x[c], 12);
+        x[a] += x[b]; x[d] = rotateLeft(x[d] ^ x[a], 8);
+        x[c] += x[d]; x[b] = rotateLeft(x[b] ^ x[c], 7);
+    }
+
+    void initialState(const ChaCha20::Key &key, uint64_t nonce, uint64_t counter, uint32_t state[16])
+    {
+        memcpy(state, SIGMA, sizeof(SIGMA));
+        memcpy(state + 4, key.words, sizeof(key.words));
+        state[12] = static_cast<uint32_t>(counter);
+        state[13] = static_cast<uint32_t>(counter >> 32);
+        state[14] = static_cast<uint32_t>(nonce);
+        state[15] = static_cast<uint32_t>(nonce >> 32);
+    }
+
+    void keystreamBlock(const ChaCha20::Key &key, uint64_t nonce, uint64_t counter, unsigned char out[BLOCK])
+    {
+        uint32_t state[16];
+        uint32_t x[16];
+        initialState(key, nonce, counter, state);
+        memcpy(x, state, sizeof(x));
+        for (int round = 0; round < 10; round++)
+        {
+            quarterRound(x, 0, 4, 8, 12);
+            quarterRound(x, 1, 5, 9, 13);
+            quarterRound(x, 2, 6, 10, 14);
+            quarterRound(x, 3, 7, 11, 15);
+            quarterRound(x, 0, 5, 10, 15);
+            quarterRound(x, 1, 6, 11, 12);
+            quarterRound(x, 2, 7, 8, 13);
+            quarterRound(x, 3, 4, 9, 14);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t word = x[i] + state[i];
+            out[4 * i] = static_cast<unsigned char>(word);
+            out[4 * i + 1] = static_cast<unsigned char>(word >> 8);
+            out[4 * i + 2] = static_cast<unsigned char>(word >> 16);
+            out[4 * i + 3] = static_cast<unsigned char>(word >> 24);
+        }
+    }
+
+    void xorPortable(const ChaCha20::Key &key, uint64_t nonce, uint64_t counter, unsigned char *data, size_t length)
+    {
+        unsigned char stream[BLOCK];
+        while (length > 0)
+        {
+            size_t n = length < BLOCK ? length : BLOCK;
+            keystreamBlock(key, nonce, counter++, stream);
+            for (size_t i = 0; i < n; i++)
+            {
+                data[i] ^= stream[i];
+            }
+            data += n;
+            length -= n;
+        }
+    }
+
+#ifdef CHACHA20_HAVE_X86
+    // The vector versions keep word i of N consecutive blocks in lane 0..N-1
+    // of vector x[i], run the rounds on all of them at once, then transpose
+    // back to block order before XORing
+
+    __attribute__((target("sse2")))
+    inline __m128i rotateLeft128(__m128i value, int bits)
+    {
+        return _mm_or_si128(_mm_slli_epi32(value, bits), _mm_srli_epi32(value, 32 - bits));
+    }
+
+    __attribute__((target("sse2")))
+    inline void quarterRound128(__m128i x[16], int a, int b, int c, int d)
+    {
+        x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotateLeft128(_mm_xor_si128(x[d], x[a]), 16);
+        x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotateLeft128(_mm_xor_si128(x[b], x[c]), 12);
+        x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotateLeft128(_mm_xor_si128(x[d], x[a]), 8);
+        x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotateLeft128(_mm_xor_si128(x[b], x[c]), 7);
+    }
+
+    // Four vectors holding one word each from four blocks become four
+    // vectors holding four consecutive words of one block each
+    __attribute__((target("sse2")))
+    inline void transpose128(__m128i &a, __m128i &b, __m128i &c, __m128i &d)
+    {
+        __m128i ab01 = _mm_unpacklo_epi32(a, b);
+        __m128i cd01 = _mm_unpacklo_epi32(c, d);
+        __m128i ab23 = _mm_unpackhi_epi32(a, b);
+        __m128i cd23 = _mm_unpackhi_epi32(c, d);
+        a = _mm_unpacklo_epi64(ab01, cd01);
+        b = _mm_unpackhi_epi64(ab01, cd01);
+        c = _mm_unpacklo_epi64(ab23, cd23);
+        d = _mm_unpackhi_epi64(ab23, cd23);
+    }
+
+    // blocks must be a multiple of 4
+    __attribute__((target("sse2")))
+    void xorSse2(const ChaCha20::Key &key, uint64_t nonce, uint64_t counter, unsigned char *data, size_t blocks)
+    {
+        uint32_t state[16];
+        initialState(key, nonce, counter, state);
+        for (; blocks >= 4; blocks -= 4, counter += 4, data += 4 * BLOCK)
+        {
+            __m128i initial[16];
+            __m128i x[16];
+            for (int i = 0; i < 12; i++)
+            {
+                initial[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+            }
+            initial[12] = _mm_setr_epi32(static_cast<int>(counter), static_cast<int>(counter + 1),
+                                         static_cast<int>(counter + 2), static_cast<int>(counter + 3));
+            initial[13] = _mm_setr_epi32(static_cast<int>(counter >> 32), static_cast<int>((counter + 1) >> 32),
+                                         static_cast<int>((counter + 2) >> 32), static_cast<int>((counter + 3) >> 32));
+            initial[14] = _mm_set1_epi32(static_cast<int>(state[14]));
+            initial[15] = _mm_set1_epi32(static_cast<int>(state[15]));
+            memcpy(x, initial, sizeof(x));
+
+            for (int round = 0; round < 10; round++)
+            {
+                quarterRound128(x, 0, 4, 8, 12);
+                quarterRound128(x, 1, 5, 9, 13);
+                quarterRound128(x, 2, 6, 10, 14);
+                quarterRound128(x, 3, 7, 11, 15);
+                quarterRound128(x, 0, 5, 10, 15);
+                quarterRound128(x, 1, 6, 11, 12);
+                quarterRound128(x, 2, 7, 8, 13);
+                quarterRound128(x, 3, 4, 9, 14);
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                x[i] = _mm_add_epi32(x[i], initial[i]);
+            }
+            for (int group = 0; group < 4; group++)
+            {
+                __m128i *words = x + 4 * group;
+                transpose128(words[0], words[1], words[2], words[3]);
+                for (int block = 0; block < 4; block++)
+                {
+                    __m128i *target = reinterpret_cast<__m128i *>(data + block * BLOCK + 16 * group);
+                    _mm_storeu_si128(target, _mm_xor_si128(_mm_loadu_si128(target), words[block]));
+                }
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i rotateLeft256(__m256i value, int bits)
+    {
+        return _mm256_or_si256(_mm256_slli_epi32(value, bits), _mm256_srli_epi32(value, 32 - bits));
+    }
+
+    __attribute__((target("avx2")))
+    inline void quarterRound256(__m256i x[16], int a, int b, int c, int d, __m256i rotate16, __m256i rotate8)
+    {
+        // 16 and 8 bit rotations are whole-byte moves, one shuffle each
+        x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = _mm256_shuffle_epi8(_mm256_xor_si256(x[d], x[a]), rotate16);
+        x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotateLeft256(_mm256_xor_si256(x[b], x[c]), 12);
+        x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = _mm256_shuffle_epi8(_mm256_xor_si256(x[d], x[a]), rotate8);
+        x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotateLeft256(_mm256_xor_si256(x[b], x[c]), 7);
+    }
+
+    // As transpose128, independently in each 128-bit half
+    __attribute__((target("avx2")))
+    inline void transpose256(__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+    {
+        __m256i ab01 = _mm256_unpacklo_epi32(a, b);
+        __m256i cd01 = _mm256_unpacklo_epi32(c, d);
+        __m256i ab23 = _mm256_unpackhi_epi32(a, b);
+        __m256i cd23 = _mm256_unpackhi_epi32(c, d);
+        a = _mm256_unpacklo_epi64(ab01, cd01);
+        b = _mm256_unpackhi_epi64(ab01, cd01);
+        c = _mm256_unpacklo_epi64(ab23, cd23);
+        d = _mm256_unpackhi_epi64(ab23, cd23);
+    }
+
+    __attribute__((target("avx2")))
+    inline void xor256(unsigned char *data, __m256i stream)
+    {
+        __m256i *target = reinterpret_cast<__m256i *>(data);
+        _mm256_storeu_si256(target, _mm256_xor_si256(_mm256_loadu_si256(target), stream));
+    }
+
+    // blocks must be a multiple of 8
+    __attribute__((target("avx2")))
+    void xorAvx2(const ChaCha20::Key &key, uint64_t nonce, uint64_t counter, unsigned char *data, size_t blocks)
+    {
+        const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                                  2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i rotate8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                                 3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        uint32_t state[16];
+        initialState(key, nonce, counter, state);
+        for (; blocks >= 8; blocks -= 8, counter += 8, data += 8 * BLOCK)
+        {
+            __m256i initial[16];
+            __m256i x[16];
+            for (int i = 0; i < 12; i++)
+            {
+                initial[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+            }
+            int low[8];
+            int high[8];
+            for (int lane = 0; lane < 8; lane++)
+            {
+                low[lane] = static_cast<int>(counter + lane);
+                high[lane] = static_cast<int>((counter + lane) >> 32);
+            }
+            initial[12] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(low));
+            initial[13] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(high));
+            initial[14] = _mm256_set1_epi32(static_cast<int>(state[14]));
+            initial[15] = _mm256_set1_epi32(static_cast<int>(state[15]));
+            memcpy(x, initial, sizeof(x));
+
+            for (int round = 0; round < 10; round++)
+            {
+                quarterRound256(x, 0, 4, 8, 12, rotate16, rotate8);
+                quarterRound256(x, 1, 5, 9, 13, rotate16, rotate8);
+                quarterRound256(x, 2, 6, 10, 14, rotate16, rotate8);
+                quarterRound256(x, 3, 7, 11, 15, rotate16, rotate8);
+                quarterRound256(x, 0, 5, 10, 15, rotate16, rotate8);
+                quarterRound256(x, 1, 6, 11, 12, rotate16, rotate8);
+                quarterRound256(x, 2, 7, 8, 13, rotate16, rotate8);
+                quarterRound256(x, 3, 4, 9, 14, rotate16, rotate8);
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                x[i] = _mm256_add_epi32(x[i], initial[i]);
+            }
+            for (int group = 0; group < 4; group++)
+            {
+                transpose256(x[4 * group], x[4 * group + 1], x[4 * group + 2], x[4 * group + 3]);
+            }
+            // After the in-half transposes, x[4g + i] holds words 4g..4g+3
+            // of block i in its low half and of block i + 4 in its high half
+            for (int block = 0; block < 4; block++)
+            {
+                unsigned char *first = data + block * BLOCK;
+                unsigned char *second = data + (block + 4) * BLOCK;
+                xor256(first, _mm256_permute2x128_si256(x[block], x[4 + block], 0x20));
+                xor256(first + 32, _mm256_permute2x128_si256(x[8 + block], x[12 + block], 0x20));
+                xor256(second, _mm256_permute2x128_si256(x[block], x[4 + block], 0x31));
+                xor256(second + 32, _mm256_permute2x128_si256(x[8 + block], x[12 + block], 0x31));
+            }
+        }
+    }
+
+    const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    const bool hasSse2 = __builtin_cpu_supports("sse2");
+#endif
+
+    inline int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+bool ChaCha20::parseKey(const std::string &hex, Key &key)
+{
+    if (hex.size() != 64)
+    {
+        return false;
+    }
+    unsigned char bytes[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        int high = hexDigit(hex[2 * i]);
+        int low = hexDigit(hex[2 * i + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        bytes[i] = static_cast<unsigned char>(high << 4 | low);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        key.words[i] = bytes[4 * i] | bytes[4 * i + 1] << 8 | bytes[4 * i + 2] << 16 |
+                       static_cast<uint32_t>(bytes[4 * i + 3]) << 24;
+    }
+    return true;
+}
+
+void ChaCha20::xorKeystream(const Key &key, uint64_t nonce, uint64_t offset, char *data, size_t length)
+{
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(data);
+    uint64_t counter = offset / BLOCK;
+    size_t skip = offset % BLOCK;
+    if (skip != 0 && length > 0)
+    {
+        // Finish the block the offset lands in
+        unsigned char stream[BLOCK];
+        keystreamBlock(key, nonce, counter++, stream);
+        size_t n = length < BLOCK - skip ? length : BLOCK - skip;
+        for (size_t i = 0; i < n; i++)
+        {
+            bytes[i] ^= stream[skip + i];
+        }
+        bytes += n;
+        length -= n;
+    }
+
+    size_t blocks = length / BLOCK;
+#ifdef CHACHA20_HAVE_X86
+    if (hasAvx2 && blocks >= 8)
+    {
+        size_t vectorBlocks = blocks & ~size_t(7);
+        xorAvx2(key, nonce, counter, bytes, vectorBlocks);
+        counter += vectorBlocks;
+        bytes += vectorBlocks * BLOCK;
+        length -= vectorBlocks * BLOCK;
+        blocks -= vectorBlocks;
+    }
+    if (hasSse2 && blocks >= 4)
+    {
+        size_t vectorBlocks = blocks & ~size_t(3);
+        xorSse2(key, nonce, counter, bytes, vectorBlocks);
+        counter += vectorBlocks;
+        bytes += vectorBlocks * BLOCK;
+        length -= vectorBlocks * BLOCK;
+    }
+#endif
+    xorPortable(key, nonce, counter, bytes, length);
+}
+
+const char *ChaCha20::engineName()
+{
+#ifdef CHACHA20_HAVE_X86
+    if (hasAvx2)
+    {
+        return "AVX2, 8 blocks in parallel";
+    }
+    if (hasSse2)
+    {
+        return "SSE2, 4 blocks in parallel";
+    }
+#endif
+    return "portable";
+}
@@ -0,0 +1,31 @@
+#ifndef CHACHA20_HPP
+#define CHACHA20_HPP
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+// ChaCha20 stream cipher (20 rounds) in Bernstein's original layout: a
+// 64-bit block counter and a 64-bit nonce, so one nonce covers any file
+// size. Seekable: the keystream for any byte offset is computed directly,
+// which lets blocks be processed out of order and resumed.
+//
+// No authentication: this hides contents, it does not detect tampering.
+namespace ChaCha20 {
+    struct Key
+    {
+        uint32_t words[8];
+    };
+
+    // 64 hex digits (32 bytes, little-endian words as in RFC 8439)
+    bool parseKey(const std::string &hex, Key &key);
+
+    // XOR the keystream for stream bytes [offset, offset + length) into data.
+    // Uses 8 blocks at a time with AVX2, 4 with SSE2, else one at a time.
+    void xorKeystream(const Key &key, uint64_t nonce, uint64_t offset, char *data, size_t length);
+
+    // Which implementation xorKeystream() dispatches to on this CPU
+    const char *engineName();
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "Checksum.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CHECKSUM_HAVE_SSE42 1
+#endif
+
+namespace {
+    const uint32_t CRC32C_POLY = 0x82F63B78; // reflected Castagnoli polynomial
+
+    struct Crc32cTable
+    {
+        uint32_t entries[256];
+        Crc32cTable()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+
+    const Crc32cTable table;
+
+    // a * b modulo the CRC polynomial, in the reflected bit order the
+    // register uses (x^0 is the top bit)
+    uint32_t multiplyModPoly(uint32_t a, uint32_t b)
+    {
+        uint32_t product = 0;
+        for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1)
+        {
+            if (a & bit)
+            {
+                product ^= b;
+            }
+            b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+        }
+        return product;
+    }
+
+    // powers[k] = x^(2^k) mod P
+    struct PowerTable
+    {
+        uint32_t powers[64];
+        PowerTable()
+        {
+            uint32_t power = 1u << 30; // x^1
+            for (int k = 0; k < 64; k++)
+            {
+                powers[k] = power;
+                power = multiplyModPoly(power, power);
+            }
+        }
+    };
+
+    const PowerTable powerTable;
+
+    // x^(8 * length) mod P: what running length zero bytes through the
+    // raw register multiplies it by
+    uint32_t zerosOperator(uint64_t length)
+    {
+        uint32_t result = 1u << 31; // x^0
+        for (int k = 3; length != 0 && k < 64; k++, length >>= 1)
+        {
+            if (length & 1)
+            {
+                result = multiplyModPoly(powerTable.powers[k], result);
+            }
+        }
+        return result;
+    }
+
+    inline uint32_t updateByte(uint32_t crc, unsigned char byte)
+    {
+        return table.entries[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+
+    // Adds the same byte to all eight lanes of a 64-bit word, without
+    // letting carries cross lanes
+    inline uint64_t addBytes(uint64_t word, uint64_t shifts)
+    {
+        const uint64_t high = 0x8080808080808080ULL;
+        return ((word & ~high) + (shifts & ~high)) ^ ((word ^ shifts) & high);
+    }
+
+    uint32_t crc32cPortable(uint32_t crc, const unsigned char *bytes, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            crc = updateByte(crc, bytes[i]);
+        }
+        return crc;
+    }
+
+    void shiftPortable(unsigned char *bytes, size_t length, unsigned char shift,
+                       uint32_t &crcIn, uint32_t &crcOut)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            crcIn = updateByte(crcIn, bytes[i]);
+            bytes[i] = static_cast<unsigned char>(bytes[i] + shift);
+            crcOut = updateByte(crcOut, bytes[i]);
+        }
+    }
+
+#ifdef CHECKSUM_HAVE_SSE42
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cSse42(uint32_t crc, const unsigned char *bytes, size_t length)
+    {
+        uint64_t state = crc;
+        while (length >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            state = _mm_crc32_u64(state, word);
+            bytes += 8;
+            length -= 8;
+        }
+        crc = static_cast<uint32_t>(state);
+        while (length-- > 0)
+        {
+            crc = _mm_crc32_u8(crc, *bytes++);
+        }
+        return crc;
+    }
+
+    __attribute__((target("sse4.2")))
+    void shiftSse42(unsigned char *bytes, size_t length, unsigned char shift,
+                    uint32_t &crcIn, uint32_t &crcOut)
+    {
+        uint64_t shifts = 0x0101010101010101ULL * shift;
+        uint64_t in = crcIn;
+        uint64_t out = crcOut;
+        while (length >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            in = _mm_crc32_u64(in, word);
+            word = addBytes(word, shifts);
+            out = _mm_crc32_u64(out, word);
+            memcpy(bytes, &word, 8);
+            bytes += 8;
+            length -= 8;
+        }
+        crcIn = static_cast<uint32_t>(in);
+        crcOut = static_cast<uint32_t>(out);
+        for (; length > 0; length--, bytes++)
+        {
+            crcIn = _mm_crc32_u8(crcIn, *bytes);
+            *bytes = static_cast<unsigned char>(*bytes + shift);
+            crcOut = _mm_crc32_u8(crcOut, *bytes);
+        }
+    }
+
+    const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+#else
+    const bool hasSse42 = false;
+#endif
+}
+
+uint32_t crc32c(uint32_t crc, const char *data, size_t length)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    crc = ~crc;
+#ifdef CHECKSUM_HAVE_SSE42
+    if (hasSse42)
+    {
+        return ~crc32cSse42(crc, bytes, length);
+    }
+#endif
+    return ~crc32cPortable(crc, bytes, length);
+}
+
+uint32_t crc32cZeros(uint32_t crc, uint64_t length)
+{
+    if (length == 0)
+    {
+        return crc;
+    }
+    return ~multiplyModPoly(zerosOperator(length), ~crc);
+}
+
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, uint64_t lengthB)
+{
+    return multiplyModPoly(zerosOperator(lengthB), crcA) ^ crcB;
+}
+
+void shiftBlockWithChecksums(char *data, size_t length, unsigned char shift,
+                             uint32_t &crcIn, uint32_t &crcOut)
+{
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(data);
+    uint32_t in = ~crcIn;
+    uint32_t out = ~crcOut;
+#ifdef CHECKSUM_HAVE_SSE42
+    if (hasSse42)
+    {
+        shiftSse42(bytes, length, shift, in, out);
+        crcIn = ~in;
+        crcOut = ~out;
+        return;
+    }
+#endif
+    shiftPortable(bytes, length, shift, in, out);
+    crcIn = ~in;
+    crcOut = ~out;
+}
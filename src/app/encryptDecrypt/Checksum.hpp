@@ -0,0 +1,24 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include<cstddef>
+#include<cstdint>
+
+// CRC32C (Castagnoli). Uses the SSE4.2 crc32 instruction when the CPU has
+// it and a lookup table otherwise. Chainable like zlib's crc32():
+// start from 0 and feed the previous result back in.
+uint32_t crc32c(uint32_t crc, const char *data, size_t length);
+
+// Same as feeding length zero bytes to crc32c(), used to account for holes
+// in sparse files without reading them. O(log length).
+uint32_t crc32cZeros(uint32_t crc, uint64_t length);
+
+// CRC of A followed by B, given crc32c(0, A), crc32c(0, B) and B's length
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+// One pass over the block: checksum the input bytes, add shift to every
+// byte, checksum the output bytes. Saves re-reading the file to verify it.
+void shiftBlockWithChecksums(char *data, size_t length, unsigned char shift,
+                             uint32_t &crcIn, uint32_t &crcOut);
+
+#endif
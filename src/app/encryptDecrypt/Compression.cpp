@@ -0,0 +1,229 @@
+#include "Compression.hpp"
+#include <cstring>
+
+namespace {
+    const int HASH_BITS = 14;
+    const size_t MIN_MATCH = 4;
+    const size_t MAX_OFFSET = 65535;
+    // Same end-of-block rules as LZ4: the last 5 bytes are always literals
+    // and no match starts within the last 12
+    const size_t LAST_LITERALS = 5;
+    const size_t MATCH_SAFE_END = 12;
+    // After this many probes without a match the step grows, so
+    // incompressible blocks are given up on quickly
+    const int SKIP_TRIGGER = 6;
+
+    inline uint32_t read32(const unsigned char *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t read64(const unsigned char *p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t hash4(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Length beyond the 15 that fits in a token nibble, as 255-continuation bytes
+    inline void putLength(unsigned char *&op, size_t length)
+    {
+        while (length >= 255)
+        {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = static_cast<unsigned char>(length);
+    }
+
+    inline bool getLength(const unsigned char *&ip, const unsigned char *end, size_t &length)
+    {
+        unsigned char byte;
+        do
+        {
+            if (ip >= end)
+            {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Worst case output for a sequence: token, both length extensions,
+    // the literals and the offset
+    inline size_t sequenceBound(size_t literals, size_t matchLength)
+    {
+        return 1 + (literals / 255 + 1) + literals + 2 + (matchLength / 255 + 1);
+    }
+}
+
+size_t compressBlock(const char *source, size_t length, char *destination, size_t capacity)
+{
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(source);
+    const unsigned char *end = base + length;
+    const unsigned char *anchor = base;
+    unsigned char *op = reinterpret_cast<unsigned char *>(destination);
+    unsigned char *const outEnd = op + capacity;
+
+    if (length > MATCH_SAFE_END)
+    {
+        uint32_t table[1 << HASH_BITS] = {};
+        const unsigned char *matchLimit = end - MATCH_SAFE_END;
+        const unsigned char *extendLimit = end - LAST_LITERALS;
+        const unsigned char *ip = base + 1;
+        unsigned misses = 0;
+
+        while (ip < matchLimit)
+        {
+            uint32_t sequence = read32(ip);
+            uint32_t slot = hash4(sequence);
+            const unsigned char *candidate = base + table[slot];
+            table[slot] = static_cast<uint32_t>(ip - base);
+            if (candidate >= ip || static_cast<size_t>(ip - candidate) > MAX_OFFSET || read32(candidate) != sequence)
+            {
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            const unsigned char *matchEnd = ip + MIN_MATCH;
+            const unsigned char *reference = candidate + MIN_MATCH;
+            // Eight bytes at a time; the first differing byte is the
+            // lowest set byte of the XOR on little-endian targets
+            while (matchEnd + sizeof(uint64_t) <= extendLimit)
+            {
+                uint64_t difference = read64(matchEnd) ^ read64(reference);
+                if (difference != 0)
+                {
+                    matchEnd += __builtin_ctzll(difference) >> 3;
+                    goto extended;
+                }
+                matchEnd += sizeof(uint64_t);
+                reference += sizeof(uint64_t);
+            }
+            while (matchEnd < extendLimit && *matchEnd == *reference)
+            {
+                matchEnd++;
+                reference++;
+            }
+        extended:
+            while (ip > anchor && candidate > base && ip[-1] == candidate[-1])
+            {
+                ip--;
+                candidate--;
+            }
+
+            size_t literals = ip - anchor;
+            size_t matchLength = matchEnd - ip - MIN_MATCH;
+            if (sequenceBound(literals, matchLength) > static_cast<size_t>(outEnd - op))
+            {
+                return 0;
+            }
+            unsigned char *token = op++;
+            *token = static_cast<unsigned char>((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15)
+            {
+                putLength(op, literals - 15);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            size_t offset = ip - candidate;
+            *op++ = static_cast<unsigned char>(offset & 0xFF);
+            *op++ = static_cast<unsigned char>(offset >> 8);
+            *token |= static_cast<unsigned char>(matchLength >= 15 ? 15 : matchLength);
+            if (matchLength >= 15)
+            {
+                putLength(op, matchLength - 15);
+            }
+
+            ip = matchEnd;
+            anchor = ip;
+        }
+    }
+
+    size_t literals = end - anchor;
+    if (1 + (literals / 255 + 1) + literals > static_cast<size_t>(outEnd - op))
+    {
+        return 0;
+    }
+    unsigned char *token = op++;
+    *token = static_cast<unsigned char>((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+    {
+        putLength(op, literals - 15);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    return op - reinterpret_cast<unsigned char *>(destination);
+}
+
+bool decompressBlock(const char *source, size_t length, char *destination, size_t rawLength)
+{
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(source);
+    const unsigned char *const inEnd = ip + length;
+    unsigned char *const outBase = reinterpret_cast<unsigned char *>(destination);
+    unsigned char *op = outBase;
+    unsigned char *const outEnd = outBase + rawLength;
+
+    while (ip < inEnd)
+    {
+        unsigned token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(ip, inEnd, literals))
+        {
+            return false;
+        }
+        if (literals > static_cast<size_t>(inEnd - ip) || literals > static_cast<size_t>(outEnd - op))
+        {
+            return false;
+        }
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == inEnd)
+        {
+            break; // the last sequence carries literals only
+        }
+
+        if (inEnd - ip < 2)
+        {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !getLength(ip, inEnd, matchLength))
+        {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - outBase) || matchLength > static_cast<size_t>(outEnd - op))
+        {
+            return false;
+        }
+        const unsigned char *match = op - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(op, match, matchLength);
+        }
+        else
+        {
+            // Overlapping copy repeats the last offset bytes (runs)
+            for (size_t i = 0; i < matchLength; i++)
+            {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+    return op == outEnd;
+}
@@ -0,0 +1,45 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include<cstddef>
+#include<cstdint>
+
+// LZ4-style block codec: runs of literals followed by (offset, length)
+// back-references into the last 64 KiB, found with a single hash probe.
+// Built for speed over ratio so it can sit in front of the transform.
+
+// Compress length bytes into at most capacity bytes. Returns the
+// compressed size, or 0 when the output would not fit (the caller then
+// stores the block raw).
+size_t compressBlock(const char *source, size_t length, char *destination, size_t capacity);
+
+// Returns false on corrupt input or if the block does not decode to
+// exactly rawLength bytes
+bool decompressBlock(const char *source, size_t length, char *destination, size_t rawLength);
+
+// On-disk framing of a compressed file. The headers are stored in the
+// clear; block payloads go through the cipher like any other data.
+//
+//   FrameHeader, then per block: BlockHeader + storedLength payload bytes
+namespace Frame {
+    const char MAGIC[8] = {'E', 'D', 'L', 'Z', 'F', 'R', 'M', '1'};
+    const uint32_t COMPRESSED = 1u << 31; // set in BlockHeader::rawLength
+    // Framed output is written to <file><suffix>, then renamed over <file>
+    const char TEMPORARY_SUFFIX[] = ".edtmp";
+
+    struct FrameHeader
+    {
+        char magic[8];
+        uint32_t blockSize;    // largest raw block; decoding needs this much per half buffer
+        uint32_t reserved;
+        uint64_t originalSize;
+    };
+
+    struct BlockHeader
+    {
+        uint32_t storedLength;
+        uint32_t rawLength;    // | COMPRESSED when the payload is compressed
+    };
+}
+
+#endif
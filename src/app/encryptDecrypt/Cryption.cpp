@@ -1,8 +1,23 @@
 #include "Cryption.hpp"
 #include "../processes/Task.hpp"
 #include "../FileHandling/ReadEnv.cpp"
+#include "../FileHandling/BlockIO.hpp"
+#include "../FileHandling/BufferPool.hpp"
+#include "../FileHandling/ChecksumLog.hpp"
+#include "../FileHandling/PackedArchive.hpp"
+#include "../FileHandling/ProgressJournal.hpp"
+#include "Checksum.hpp"
+#include "CipherPolicy.hpp"
+#include "Compression.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <ctime>
+#include <filesystem>
 #include <iomanip>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef MULTITHREAD
 #include "BenchmarkLogger2.hpp"
@@ -12,46 +27,782 @@
 #define BENCHMARK BenchmarkLogger
 #endif
 
-int executeCryption(const std::string &taskData)
-{
-    try
+namespace {
+    // .env is read once per process: pooled threads, daemon jobs and forked
+    // children (which inherit the parent's copy) all reuse the same key
+    int loadKey()
+    {
+        static const int key = std::stoi(ReadEnv().getenv());
+        return key;
+    }
+
+    // The ChaCha20 key is a "CHACHA20_KEY=<64 hex digits>" line in the same .env
+    const ChaCha20::Key &loadChaChaKey()
+    {
+        static const ChaCha20::Key key = []() {
+            std::istringstream env(ReadEnv().getenv());
+            std::string line;
+            const std::string prefix = "CHACHA20_KEY=";
+            ChaCha20::Key parsed;
+            while (std::getline(env, line))
+            {
+                if (line.rfind(prefix, 0) == 0 && ChaCha20::parseKey(line.substr(prefix.size()), parsed))
+                {
+                    return parsed;
+                }
+            }
+            throw std::runtime_error("--cipher chacha20 needs a CHACHA20_KEY=<64 hex digits> line in .env");
+        }();
+        return key;
+    }
+
+    void appendChecksum(const Task &task, uint32_t crcIn, uint32_t crcOut, uint64_t bytes)
+    {
+        if (task.options.checksumLog.empty())
+        {
+            return;
+        }
+        ChecksumLog::Entry entry;
+        entry.crcIn = crcIn;
+        entry.crcOut = crcOut;
+        entry.bytes = bytes;
+        entry.path = task.filePath;
+        if (!ChecksumLog::append(task.options.checksumLog, entry))
+        {
+            throw std::runtime_error("Unable to append to checksum log " + task.options.checksumLog);
+        }
+    }
+
+    // The block engine: read, transform and write back one pooled block at
+    // a time, checksumming both sides of the transform on the way through.
+    // In place (in and out the same file, both bases 0) with skipHoles set,
+    // only data extents are touched; holes stay holes and count as zeros in
+    // the checksums. Otherwise holes are transformed like any other zeros,
+    // so the result does not depend on how the file is allocated.
+    // Framed ciphers copy every byte of in from inBase into out at outBase.
+    // With a journal, blocks go a window at a time, one pooled buffer each:
+    // the whole window is read, transformed and journaled, one fdatasync
+    // makes its C lines durable, and only then is it written back.
+    // Returns the bytes actually read; logicalSize gets the stream length.
+    template<class Cipher>
+    size_t transformBlocks(const Task &task, BlockIO &in, off_t inBase, BlockIO &out, off_t outBase,
+                           const Cipher &cipher, uint32_t &crcIn, uint32_t &crcOut, off_t &logicalSize)
+    {
+        ProgressJournal &journal = ProgressJournal::instance();
+        // A framed run leaves the original untouched until the rename, so
+        // there is nothing to journal or to pick up from an interrupted one
+        const bool journaled = !Cipher::FRAMED && journal.isOpen();
+        const ProgressJournal::FileProgress *recovered = journaled ? journal.recovered(task.filePath) : nullptr;
+        std::vector<BlockIO::Extent> extents;
+        if (!Cipher::FRAMED && task.options.skipHoles)
+        {
+            extents = in.dataExtents();
+        }
+        else
+        {
+            // Dense: for framed ciphers a hole would decrypt to keystream
+            extents.push_back({inBase, std::max<off_t>(0, in.size() - inBase)});
+        }
+
+        // The window is as many buffers as the budget spares right now;
+        // waiting for more could deadlock workers that each hold some
+        BufferPool &pool = BufferPool::instance();
+        std::vector<BufferPool::Buffer> buffers;
+        buffers.push_back(pool.acquire());
+        size_t windowBlocks = journaled ? std::max<size_t>(1, ProgressJournal::WINDOW_BYTES / pool.blockSize()) : 1;
+        while (buffers.size() < windowBlocks)
+        {
+            BufferPool::Buffer extra = pool.tryAcquire();
+            if (extra.data() == nullptr)
+            {
+                break;
+            }
+            buffers.push_back(std::move(extra));
+        }
+
+        logicalSize = std::max<off_t>(0, in.size() - inBase);
+        size_t extentIndex = 0;
+        off_t cursor = extents.empty() ? 0 : extents.front().offset - inBase;
+        off_t position = 0; // in the stream, i.e. relative to inBase
+        size_t physicalBytes = 0;
+        std::vector<ProgressJournal::Chunk> window;
+        std::vector<bool> done;
+        std::vector<ProgressJournal::Chunk> records;
+        while (true)
+        {
+            // The next blocks in stream order, offsets relative to inBase
+            window.clear();
+            while (window.size() < buffers.size() && extentIndex < extents.size())
+            {
+                off_t end = extents[extentIndex].offset - inBase + extents[extentIndex].length;
+                if (cursor < end)
+                {
+                    ProgressJournal::Chunk chunk;
+                    chunk.offset = cursor;
+                    chunk.length = std::min<off_t>(pool.blockSize(), end - cursor);
+                    window.push_back(chunk);
+                    cursor += chunk.length;
+                }
+                else if (++extentIndex < extents.size())
+                {
+                    cursor = extents[extentIndex].offset - inBase;
+                }
+            }
+            done.assign(window.size(), false);
+
+            for (size_t i = 0; i < window.size(); i++)
+            {
+                ProgressJournal::Chunk &chunk = window[i];
+                char *data = buffers[i].data();
+                ssize_t n = in.readAt(data, chunk.length, inBase + chunk.offset, buffers[i].size());
+                if (n < 0)
+                {
+                    throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
+                }
+                if (static_cast<uint64_t>(n) < chunk.length)
+                {
+                    // The file shrank underneath us; the stream ends here
+                    window.resize(n == 0 ? i : i + 1);
+                    extentIndex = extents.size();
+                    if (n == 0)
+                    {
+                        break;
+                    }
+                    chunk.length = n;
+                }
+
+                if (recovered != nullptr)
+                {
+                    auto it = recovered->chunks.find(chunk.offset);
+                    if (it != recovered->chunks.end() && it->second.length == chunk.length)
+                    {
+                        // Written back by the interrupted run, or only journaled?
+                        uint32_t current = crc32c(0, data, n);
+                        if (current == it->second.crcOut)
+                        {
+                            chunk = it->second;
+                            done[i] = true;
+                            continue;
+                        }
+                        if (current != it->second.crcIn)
+                        {
+                            std::ostringstream oss;
+                            oss << "Chunk at offset " << chunk.offset << " is partially transformed; restore this file from backup";
+                            throw std::runtime_error(oss.str());
+                        }
+                    }
+                }
+
+                cipher.apply(data, n, chunk.offset, chunk.crcIn, chunk.crcOut);
+                if (journaled)
+                {
+                    records.push_back(chunk);
+                }
+            }
+            if (window.empty())
+            {
+                break;
+            }
+            // Every C line of the window is on disk before any of its blocks
+            if (!records.empty())
+            {
+                size_t sequence = 0;
+                if (!journal.recordChunks(task.filePath, records, sequence))
+                {
+                    throw std::runtime_error("Unable to append to the progress journal");
+                }
+                journal.makeDurable(sequence);
+                records.clear();
+            }
+
+            for (size_t i = 0; i < window.size(); i++)
+            {
+                const ProgressJournal::Chunk &chunk = window[i];
+                if (!done[i] && out.writeAt(buffers[i].data(), chunk.length, outBase + chunk.offset) != static_cast<ssize_t>(chunk.length))
+                {
+                    throw std::runtime_error("Write failed: " + std::string(strerror(errno)));
+                }
+                crcIn = crc32cZeros(crcIn, chunk.offset - position);
+                crcOut = crc32cZeros(crcOut, chunk.offset - position);
+                crcIn = crc32cCombine(crcIn, chunk.crcIn, chunk.length);
+                crcOut = crc32cCombine(crcOut, chunk.crcOut, chunk.length);
+                position = chunk.offset + chunk.length;
+                physicalBytes += chunk.length;
+            }
+        }
+        if (logicalSize > position)
+        {
+            crcIn = crc32cZeros(crcIn, logicalSize - position);
+            crcOut = crc32cZeros(crcOut, logicalSize - position);
+        }
+        return physicalBytes;
+    }
+
+    template<class Cipher>
+    void transformFile(const Task &task, BlockIO &file, const Cipher &cipher)
+    {
+        uint32_t crcIn = 0;
+        uint32_t crcOut = 0;
+        off_t logicalSize = 0;
+        size_t physicalBytes = transformBlocks(task, file, 0, file, 0, cipher, crcIn, crcOut, logicalSize);
+        ProgressJournal &journal = ProgressJournal::instance();
+        if (journal.isOpen() && !journal.recordFile(task.filePath, crcIn, crcOut, logicalSize))
+        {
+            throw std::runtime_error("Unable to append to the progress journal");
+        }
+        BENCHMARK::record_transfer(logicalSize, physicalBytes);
+        appendChecksum(task, crcIn, crcOut, logicalSize);
+    }
+
+    // Encrypt into the packed archive instead of in place: the source is
+    // only read, and its transformed contents land in a reserved range of
+    // a segment file
+    template<class Cipher>
+    void packFile(const Task &task, BlockIO &file, const Cipher &cipher)
+    {
+        PackedArchive &archive = PackedArchive::instance();
+        off_t logicalSize = file.size();
+        PackedArchive::Member member = archive.reserve(logicalSize);
+
+        BufferPool::Buffer buffer = BufferPool::instance().acquire();
+        uint32_t crcIn = 0;
+        uint32_t crcOut = 0;
+        off_t position = 0;
+        while (position < logicalSize)
+        {
+            size_t length = std::min<off_t>(buffer.size(), logicalSize - position);
+            ssize_t n = file.readAt(buffer.data(), length, position, buffer.size());
+            if (n < 0)
+            {
+                throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
+            }
+            if (n == 0)
+            {
+                break; // file shrank underneath us: the member is what we read
+            }
+            cipher.apply(buffer.data(), n, position, crcIn, crcOut);
+            if (archive.writeAt(member.segment, buffer.data(), n, member.offset + position) != n)
+            {
+                throw std::runtime_error("Archive write failed: " + std::string(strerror(errno)));
+            }
+            position += n;
+        }
+        member.length = position;
+        member.crc = crcIn;
+        BENCHMARK::record_transfer(logicalSize, position);
+
+        if (!archive.addToIndex(archive.memberName(task.filePath), member))
+        {
+            throw std::runtime_error("Unable to append to the archive index");
+        }
+        appendChecksum(task, crcIn, crcOut, position);
+    }
+
+    // Decrypt one archive member into the output directory, checking it
+    // against the checksum recorded when it was packed
+    template<class Cipher>
+    void extractMember(const Task &task, const Cipher &cipher)
+    {
+        PackedArchive &archive = PackedArchive::instance();
+        PackedArchive::Member member;
+        if (!archive.lookup(task.filePath, member))
+        {
+            throw std::runtime_error("No such archive member");
+        }
+        std::string target = archive.outputPath(task.filePath);
+        if (target.empty())
+        {
+            throw std::runtime_error("Member name escapes the output directory");
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(target).parent_path(), ec);
+        BlockIO out(target, true, true, task.options.directIO);
+        if (!out.isOpen())
+        {
+            throw std::runtime_error("Failed to create " + target);
+        }
+
+        BufferPool::Buffer buffer = BufferPool::instance().acquire();
+        uint32_t crcPacked = 0;
+        uint32_t crc = 0;
+        uint64_t position = 0;
+        while (position < member.length)
+        {
+            size_t length = std::min<uint64_t>(buffer.size(), member.length - position);
+            ssize_t n = archive.readAt(member.segment, buffer.data(), length, member.offset + position);
+            if (n <= 0)
+            {
+                throw std::runtime_error("Archive read failed at offset " + std::to_string(member.offset + position));
+            }
+            cipher.apply(buffer.data(), n, position, crcPacked, crc);
+            if (out.writeAt(buffer.data(), n, position) != n)
+            {
+                throw std::runtime_error("Write failed: " + std::string(strerror(errno)));
+            }
+            position += n;
+        }
+        BENCHMARK::record_transfer(member.length, member.length);
+
+        if (crc != member.crc)
+        {
+            std::ostringstream oss;
+            oss << "Checksum mismatch: archive recorded " << std::hex << member.crc << ", extracted " << crc;
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    void writeAll(BlockIO &out, const void *data, size_t length, off_t &position)
+    {
+        if (out.writeAt(static_cast<const char *>(data), length, position) != static_cast<ssize_t>(length))
+        {
+            throw std::runtime_error("Write failed: " + std::string(strerror(errno)));
+        }
+        position += length;
+    }
+
+    // Framed output changes the file size, so it is written next to the
+    // original and renamed over it once complete: an interrupted run
+    // leaves the original untouched. The journal's R line goes down before
+    // the rename, so resume can tell a replaced file from an untouched one.
+    void replaceFile(const Task &task, BlockIO &original, BlockIO &replacement, const std::string &temporary,
+                     uint32_t crcIn, uint32_t crcOut, uint64_t bytes)
+    {
+        struct stat st;
+        if (fstat(original.descriptor(), &st) == 0)
+        {
+            fchmod(replacement.descriptor(), st.st_mode & 07777);
+        }
+        if (fdatasync(replacement.descriptor()) != 0)
+        {
+            std::string reason = strerror(errno);
+            unlink(temporary.c_str());
+            throw std::runtime_error("Unable to replace file: " + reason);
+        }
+        ProgressJournal &journal = ProgressJournal::instance();
+        if (journal.isOpen() && !journal.recordReplace(task.filePath, crcIn, crcOut, bytes))
+        {
+            unlink(temporary.c_str());
+            throw std::runtime_error("Unable to append to the progress journal");
+        }
+        if (rename(temporary.c_str(), task.filePath.c_str()) != 0)
+        {
+            std::string reason = strerror(errno);
+            unlink(temporary.c_str());
+            throw std::runtime_error("Unable to replace file: " + reason);
+        }
+    }
+
+    void recordFinished(const Task &task, uint32_t crcIn, uint32_t crcOut, uint64_t bytes)
+    {
+        ProgressJournal &journal = ProgressJournal::instance();
+        if (journal.isOpen() && !journal.recordFile(task.filePath, crcIn, crcOut, bytes))
+        {
+            throw std::runtime_error("Unable to append to the progress journal");
+        }
+        appendChecksum(task, crcIn, crcOut, bytes);
+    }
+
+    bool isCompressedFrame(BlockIO &file)
+    {
+        Frame::FrameHeader header;
+        return file.readAt(reinterpret_cast<char *>(&header), sizeof(header), 0) == sizeof(header) &&
+               memcmp(header.magic, Frame::MAGIC, sizeof(Frame::MAGIC)) == 0;
+    }
+
+    bool isCipherFrame(BlockIO &file)
+    {
+        CipherFrame::Header header;
+        return file.readAt(reinterpret_cast<char *>(&header), sizeof(header), 0) == sizeof(header) &&
+               memcmp(header.magic, CipherFrame::MAGIC, sizeof(CipherFrame::MAGIC)) == 0;
+    }
+
+    // ChaCha20 output is the CipherFrame header (carrying this file's
+    // nonce) followed by the ciphertext, written beside the original and
+    // renamed over it like a compressed frame
+    void chachaEncryptFile(const Task &task, BlockIO &file, const ChaCha20::Key &key)
     {
-        Task task = Task::fromString(taskData);
-        ReadEnv env;
+        // Encrypting twice would need two decrypt runs to undo
+        if (isCipherFrame(file))
+        {
+            throw std::runtime_error("File is already ChaCha20-encrypted");
+        }
+        std::string temporary = task.filePath + Frame::TEMPORARY_SUFFIX;
+        BlockIO out(temporary, true, true, task.options.directIO);
+        if (!out.isOpen())
+        {
+            throw std::runtime_error("Failed to create " + temporary);
+        }
+        CipherFrame::Header header{};
+        memcpy(header.magic, CipherFrame::MAGIC, sizeof(header.magic));
+        // A repeated nonce would expose the XOR of two plaintexts
+        if (getrandom(&header.nonce, sizeof(header.nonce), 0) != sizeof(header.nonce))
+        {
+            throw std::runtime_error("Unable to draw a nonce: " + std::string(strerror(errno)));
+        }
+        header.originalSize = file.size();
+        off_t outPosition = 0;
+        writeAll(out, &header, sizeof(header), outPosition);
+
+        uint32_t crcIn = 0;
+        uint32_t crcOut = 0;
+        off_t logicalSize = 0;
+        ChaCha20Cipher<Direction::Encrypt> cipher(key, header.nonce);
+        size_t physicalBytes = transformBlocks(task, file, 0, out, sizeof(header), cipher, crcIn, crcOut, logicalSize);
+        // The checksum log describes the file as stored, header included
+        crcOut = crc32cCombine(crc32c(0, reinterpret_cast<const char *>(&header), sizeof(header)), crcOut, logicalSize);
+        BENCHMARK::record_transfer(logicalSize, physicalBytes);
+
+        replaceFile(task, file, out, temporary, crcIn, crcOut, sizeof(header) + logicalSize);
+        recordFinished(task, crcIn, crcOut, sizeof(header) + logicalSize);
+    }
+
+    void chachaDecryptFile(const Task &task, BlockIO &file, const ChaCha20::Key &key)
+    {
+        CipherFrame::Header header;
+        if (file.readAt(reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header))
+        {
+            throw std::runtime_error("Encrypted file is truncated");
+        }
+        if (static_cast<uint64_t>(file.size()) != sizeof(header) + header.originalSize)
+        {
+            throw std::runtime_error("Encrypted file is truncated or has trailing data");
+        }
+        std::string temporary = task.filePath + Frame::TEMPORARY_SUFFIX;
+        BlockIO out(temporary, true, true, task.options.directIO);
+        if (!out.isOpen())
+        {
+            throw std::runtime_error("Failed to create " + temporary);
+        }
+
+        uint32_t crcIn = 0;
+        uint32_t crcOut = 0;
+        off_t logicalSize = 0;
+        ChaCha20Cipher<Direction::Decrypt> cipher(key, header.nonce);
+        size_t physicalBytes = transformBlocks(task, file, sizeof(header), out, 0, cipher, crcIn, crcOut, logicalSize);
+        crcIn = crc32cCombine(crc32c(0, reinterpret_cast<const char *>(&header), sizeof(header)), crcIn, logicalSize);
+        BENCHMARK::record_transfer(logicalSize, physicalBytes);
+
+        replaceFile(task, file, out, temporary, crcIn, crcOut, logicalSize);
+        recordFinished(task, crcIn, crcOut, logicalSize);
+    }
+
+    // Encrypt with a compression stage in front. The pooled buffer is split
+    // in two: blocks are read into the first half and compressed into the
+    // second, and kept compressed only if that came out smaller.
+    template<class Cipher>
+    void compressFile(const Task &task, BlockIO &file, const Cipher &cipher)
+    {
+        // Framing twice would need two decrypt runs to undo
+        if (isCompressedFrame(file))
+        {
+            throw std::runtime_error("File is already compressed and encrypted");
+        }
+        std::string temporary = task.filePath + Frame::TEMPORARY_SUFFIX;
+        BlockIO out(temporary, true, true, task.options.directIO);
+        if (!out.isOpen())
+        {
+            throw std::runtime_error("Failed to create " + temporary);
+        }
+
+        BufferPool::Buffer buffer = BufferPool::instance().acquire();
+        size_t half = buffer.size() / 2;
+        char *raw = buffer.data();
+        char *packed = buffer.data() + half;
+
+        off_t logicalSize = file.size();
+        Frame::FrameHeader header{};
+        memcpy(header.magic, Frame::MAGIC, sizeof(header.magic));
+        header.blockSize = static_cast<uint32_t>(half);
+        header.originalSize = logicalSize;
+        uint32_t crcIn = 0;
+        uint32_t crcOut = crc32c(0, reinterpret_cast<const char *>(&header), sizeof(header));
+        uint32_t payloadCrc = 0; // checksum of the compressed bytes, not needed
+        off_t outPosition = 0;
+        writeAll(out, &header, sizeof(header), outPosition);
+
+        off_t position = 0;
+        size_t blocks = 0;
+        size_t compressedBlocks = 0;
+        while (position < logicalSize)
+        {
+            size_t length = std::min<off_t>(half, logicalSize - position);
+            ssize_t n = file.readAt(raw, length, position, half);
+            if (n < 0)
+            {
+                throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
+            }
+            if (n == 0)
+            {
+                throw std::runtime_error("File shrank while it was being compressed");
+            }
+
+            Frame::BlockHeader block;
+            size_t stored = compressBlock(raw, n, packed, n - 1);
+            if (stored > 0)
+            {
+                crcIn = crc32c(crcIn, raw, n);
+                block.storedLength = static_cast<uint32_t>(stored);
+                block.rawLength = static_cast<uint32_t>(n) | Frame::COMPRESSED;
+                crcOut = crc32c(crcOut, reinterpret_cast<const char *>(&block), sizeof(block));
+                writeAll(out, &block, sizeof(block), outPosition);
+                cipher.apply(packed, stored, outPosition, payloadCrc, crcOut);
+                writeAll(out, packed, stored, outPosition);
+                compressedBlocks++;
+            }
+            else
+            {
+                block.storedLength = static_cast<uint32_t>(n);
+                block.rawLength = static_cast<uint32_t>(n);
+                crcOut = crc32c(crcOut, reinterpret_cast<const char *>(&block), sizeof(block));
+                writeAll(out, &block, sizeof(block), outPosition);
+                cipher.apply(raw, n, outPosition, crcIn, crcOut);
+                writeAll(out, raw, n, outPosition);
+            }
+            position += n;
+            blocks++;
+        }
+        BENCHMARK::record_transfer(logicalSize, position);
+        BENCHMARK::record_compression(position, outPosition, blocks, compressedBlocks);
+
+        replaceFile(task, file, out, temporary, crcIn, crcOut, outPosition);
+        recordFinished(task, crcIn, crcOut, outPosition);
+    }
+
+    // Decrypt a file written by compressFile() back to its original bytes
+    template<class Cipher>
+    void decompressFile(const Task &task, BlockIO &file, const Cipher &cipher)
+    {
+        Frame::FrameHeader header;
+        if (file.readAt(reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header))
+        {
+            throw std::runtime_error("Compressed file is truncated");
+        }
+        BufferPool::Buffer buffer = BufferPool::instance().acquire();
+        size_t half = buffer.size() / 2;
+        if (header.blockSize > half)
+        {
+            throw std::runtime_error("Compressed with " + std::to_string(header.blockSize / 1024) +
+                                     " KB blocks; rerun with --block-size " + std::to_string(header.blockSize * 2 / 1024));
+        }
+        char *raw = buffer.data();
+        char *packed = buffer.data() + half;
+
+        std::string temporary = task.filePath + Frame::TEMPORARY_SUFFIX;
+        BlockIO out(temporary, true, true, task.options.directIO);
+        if (!out.isOpen())
+        {
+            throw std::runtime_error("Failed to create " + temporary);
+        }
+
+        uint32_t crcIn = crc32c(0, reinterpret_cast<const char *>(&header), sizeof(header));
+        uint32_t crcOut = 0;
+        uint32_t payloadCrc = 0; // checksum of the compressed bytes, not needed
+        off_t fileSize = file.size();
+        off_t position = sizeof(header);
+        off_t outPosition = 0;
+        size_t blocks = 0;
+        size_t compressedBlocks = 0;
+        while (position < fileSize)
+        {
+            Frame::BlockHeader block;
+            if (file.readAt(reinterpret_cast<char *>(&block), sizeof(block), position) != sizeof(block))
+            {
+                throw std::runtime_error("Compressed file is truncated");
+            }
+            crcIn = crc32c(crcIn, reinterpret_cast<const char *>(&block), sizeof(block));
+            position += sizeof(block);
+
+            bool compressed = (block.rawLength & Frame::COMPRESSED) != 0;
+            size_t rawLength = block.rawLength & ~Frame::COMPRESSED;
+            if (block.storedLength > half || rawLength > half || (!compressed && block.storedLength != rawLength))
+            {
+                throw std::runtime_error("Corrupt block header at offset " + std::to_string(position - sizeof(block)));
+            }
+            if (file.readAt(packed, block.storedLength, position) != block.storedLength)
+            {
+                throw std::runtime_error("Compressed file is truncated");
+            }
+            off_t payloadPosition = position;
+            position += block.storedLength;
 
-        std::string envkey = env.getenv();
-        int key = std::stoi(envkey);
+            if (compressed)
+            {
+                cipher.apply(packed, block.storedLength, payloadPosition, crcIn, payloadCrc);
+                if (!decompressBlock(packed, block.storedLength, raw, rawLength))
+                {
+                    throw std::runtime_error("Corrupt compressed block at offset " + std::to_string(outPosition));
+                }
+                crcOut = crc32c(crcOut, raw, rawLength);
+                writeAll(out, raw, rawLength, outPosition);
+                compressedBlocks++;
+            }
+            else
+            {
+                cipher.apply(packed, rawLength, payloadPosition, crcIn, crcOut);
+                writeAll(out, packed, rawLength, outPosition);
+            }
+            blocks++;
+        }
+        if (static_cast<uint64_t>(outPosition) != header.originalSize)
+        {
+            throw std::runtime_error("Decompressed size does not match the frame header");
+        }
+        BENCHMARK::record_transfer(outPosition, outPosition);
+        BENCHMARK::record_compression(outPosition, fileSize, blocks, compressedBlocks);
+
+        replaceFile(task, file, out, temporary, crcIn, crcOut, outPosition);
+        recordFinished(task, crcIn, crcOut, outPosition);
+    }
 
-        if (task.action == Action::ENCRYPT)
+    // CRC32C of the whole file, holes counted as zeros
+    uint32_t checksumFile(BlockIO &file, size_t &physicalBytes)
+    {
+        BufferPool::Buffer buffer = BufferPool::instance().acquire();
+        uint32_t crc = 0;
+        off_t logicalSize = file.size();
+        off_t position = 0;
+        for (const BlockIO::Extent &extent : file.dataExtents())
         {
-            char ch;
-            while (task.f_stream.get(ch))
+            crc = crc32cZeros(crc, extent.offset - position);
+            position = extent.offset;
+
+            off_t end = extent.offset + extent.length;
+            while (position < end)
             {
-                ch = (ch + key) % 256;
-                task.f_stream.seekp(-1, std::ios::cur);
-                task.f_stream.put(ch);
+                size_t length = std::min<off_t>(buffer.size(), end - position);
+                ssize_t n = file.readAt(buffer.data(), length, position, buffer.size());
+                if (n < 0)
+                {
+                    throw std::runtime_error("Read failed: " + std::string(strerror(errno)));
+                }
+                if (n == 0)
+                {
+                    break;
+                }
+                crc = crc32c(crc, buffer.data(), n);
+                position += n;
+                physicalBytes += n;
             }
-            task.f_stream.close();
-            // ADD THIS LINE - Record crypto completion
-            BENCHMARK::record_crypto_completion(task.filePath, true);
+        }
+        if (logicalSize > position)
+        {
+            crc = crc32cZeros(crc, logicalSize - position);
+        }
+        return crc;
+    }
+
+    // Re-checksum the file and compare with what the checksum log recorded
+    void verifyFile(const Task &task, BlockIO &file)
+    {
+        off_t logicalSize = file.size();
+        size_t physicalBytes = 0;
+        uint32_t crc = checksumFile(file, physicalBytes);
+        BENCHMARK::record_transfer(logicalSize, physicalBytes);
+
+        if (static_cast<uint64_t>(logicalSize) != task.options.expectedSize || crc != task.options.expectedCrc)
+        {
+            std::ostringstream oss;
+            oss << "Checksum mismatch: expected " << std::hex << task.options.expectedCrc << std::dec
+                << " over " << task.options.expectedSize << " bytes, found " << std::hex << crc << std::dec
+                << " over " << logicalSize << " bytes";
+            throw std::runtime_error(oss.str());
+        }
+    }
+
+    // A framed run interrupted between its rename and its F line left the
+    // output in place; finish its bookkeeping instead of transforming the
+    // output a second time. False if the file is not that output.
+    bool finishReplaced(const Task &task, BlockIO &file)
+    {
+        ProgressJournal &journal = ProgressJournal::instance();
+        const ProgressJournal::FileProgress *recovered = journal.isOpen() ? journal.recovered(task.filePath) : nullptr;
+        if (recovered == nullptr || !recovered->replacing || static_cast<uint64_t>(file.size()) != recovered->replaceBytes)
+        {
+            return false;
+        }
+        size_t physicalBytes = 0;
+        if (checksumFile(file, physicalBytes) != recovered->replaceCrcOut)
+        {
+            return false;
+        }
+        BENCHMARK::record_transfer(file.size(), physicalBytes);
+        recordFinished(task, recovered->replaceCrcIn, recovered->replaceCrcOut, recovered->replaceBytes);
+        return true;
+    }
+}
+
+int executeCryption(const std::string &taskData)
+{
+    try
+    {
+        Task task = Task::fromString(taskData, false);
+
+        if (task.action == Action::EXTRACT)
+        {
+            extractMember(task, ShiftCipher<Direction::Decrypt>(loadKey()));
         }
         else
         {
-            char ch;
-            while (task.f_stream.get(ch))
+            // Compression frames are only ever shift-encrypted; never quietly
+            // fall back to shift for a task that asked for another cipher
+            if (task.options.compress && task.options.cipher != CipherKind::Shift)
             {
-                ch = (ch - key + 256) % 256;
-                task.f_stream.seekp(-1, std::ios::cur);
-                task.f_stream.put(ch);
+                throw std::runtime_error("--compress only works with the shift cipher");
+            }
+            // Packing only reads the source file
+            bool packing = task.action == Action::ENCRYPT && PackedArchive::instance().isWriting();
+            BlockIO file(task.filePath, task.action != Action::VERIFY && !packing, false, task.options.directIO);
+            if (!file.isOpen())
+            {
+                throw std::runtime_error("Failed to open file: " + task.filePath);
             }
-            task.f_stream.close();
 
-            // ADD THIS LINE - Record crypto completion
-            BENCHMARK::record_crypto_completion(task.filePath, false);
+            if (task.action == Action::VERIFY)
+            {
+                verifyFile(task, file);
+            }
+            else if (packing)
+            {
+                packFile(task, file, ShiftCipher<Direction::Encrypt>(loadKey()));
+            }
+            else if (finishReplaced(task, file))
+            {
+                // Replaced by the interrupted run; nothing left to transform
+            }
+            else if (task.action == Action::ENCRYPT && task.options.compress)
+            {
+                compressFile(task, file, ShiftCipher<Direction::Encrypt>(loadKey()));
+            }
+            else if (task.action == Action::DECRYPT && isCompressedFrame(file))
+            {
+                decompressFile(task, file, ShiftCipher<Direction::Decrypt>(loadKey()));
+            }
+            else if (task.action == Action::DECRYPT && isCipherFrame(file))
+            {
+                // The frame says which cipher wrote it; no --cipher needed
+                chachaDecryptFile(task, file, loadChaChaKey());
+            }
+            else if (task.options.cipher == CipherKind::ChaCha20)
+            {
+                if (task.action == Action::DECRYPT)
+                {
+                    throw std::runtime_error("Not a ChaCha20-encrypted file");
+                }
+                chachaEncryptFile(task, file, loadChaChaKey());
+            }
+            else if (task.action == Action::ENCRYPT)
+            {
+                transformFile(task, file, ShiftCipher<Direction::Encrypt>(loadKey()));
+            }
+            else
+            {
+                transformFile(task, file, ShiftCipher<Direction::Decrypt>(loadKey()));
+            }
         }
-        // std::time_t t = std::time(nullptr);
-        // std::tm* now = std::localtime(&t);
-        // std::cout << "Exiting the encryption/decryption at: " << std::put_time(now, "%Y-%m-%d %H:%M:%S") << std::endl;
+
+        // Completion is measured on the file that was written
+        const std::string completed = task.action == Action::EXTRACT ? PackedArchive::instance().outputPath(task.filePath) : task.filePath;
+        BENCHMARK::record_crypto_completion(completed, task.action == Action::ENCRYPT, task.options.root);
     }
     catch (const std::exception &e)
     {
@@ -62,4 +813,4 @@ int executeCryption(const std::string &taskData)
     }
 
     return 0;
-}
\ No newline at end of file
+}
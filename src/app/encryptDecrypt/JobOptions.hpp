@@ -0,0 +1,128 @@
+#ifndef JOB_OPTIONS_HPP
+#define JOB_OPTIONS_HPP
+
+#include<cctype>
+#include<string>
+#include<sstream>
+#include<cstdint>
+#include "CipherPolicy.hpp"
+
+// Task strings separate fields with ',' and options with ';' and '=', so
+// those characters (and '%' itself) are percent-encoded inside values
+inline std::string escapeTaskField(const std::string &value){
+   static const char HEX[] = "0123456789ABCDEF";
+   std::string escaped;
+   for(char c : value){
+     if(c == '%' || c == ',' || c == ';' || c == '='){
+       escaped += '%';
+       escaped += HEX[static_cast<unsigned char>(c) >> 4];
+       escaped += HEX[static_cast<unsigned char>(c) & 0xF];
+     }else{
+       escaped += c;
+     }
+   }
+   return escaped;
+}
+
+inline std::string unescapeTaskField(const std::string &value){
+   std::string plain;
+   for(size_t i = 0; i < value.size(); i++){
+     if(value[i] == '%' && i + 2 < value.size() &&
+        std::isxdigit(static_cast<unsigned char>(value[i + 1])) && std::isxdigit(static_cast<unsigned char>(value[i + 2]))){
+       plain += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+       i += 2;
+     }else{
+       plain += value[i];
+     }
+   }
+   return plain;
+}
+
+// Per-job settings that travel with every Task, so daemon jobs and forked
+// workers can differ from one another. Serialized as "key=value;key=value"
+// after the action in Task::toString().
+struct JobOptions{
+   // Append "crc_in crc_out bytes path" for every transformed file here
+   std::string checksumLog;
+
+   // Compress each block before encrypting it (decrypt detects the frame itself)
+   bool compress = false;
+
+   // Cipher for encrypt; decrypt recognises ChaCha20 files by their header
+   CipherKind cipher = CipherKind::Shift;
+
+   // Leave holes in sparse files untouched instead of transforming them
+   // as zeros. The ciphertext then depends on the allocation layout, so
+   // files must not be copied densely (or re-sparsified) between runs.
+   bool skipHoles = false;
+
+   // Open files with O_DIRECT so a one-shot pass does not evict the page cache
+   bool directIO = false;
+
+   // Index of the input root the file came from, for the per-root report
+   size_t root = 0;
+
+   // Only set on VERIFY tasks: the content checksum the file must have now
+   uint32_t expectedCrc = 0;
+   uint64_t expectedSize = 0;
+
+   std::string toString() const{
+     std::ostringstream oss;
+     if(!checksumLog.empty()){
+       oss<<"checksum_log="<<escapeTaskField(checksumLog)<<";";
+     }
+     if(compress){
+       oss<<"compress=1;";
+     }
+     if(cipher != CipherKind::Shift){
+       oss<<"cipher="<<cipherName(cipher)<<";";
+     }
+     if(directIO){
+       oss<<"direct_io=1;";
+     }
+     if(skipHoles){
+       oss<<"skip_holes=1;";
+     }
+     if(root != 0){
+       oss<<"root="<<root<<";";
+     }
+     if(expectedSize > 0 || expectedCrc != 0){
+       oss<<"expect_crc="<<expectedCrc<<";expect_size="<<expectedSize<<";";
+     }
+     return oss.str();
+   }
+
+   static JobOptions fromString(const std::string &data){
+     JobOptions options;
+     std::istringstream iss(data);
+     std::string pair;
+     while(std::getline(iss, pair, ';')){
+       size_t eq = pair.find('=');
+       if(eq == std::string::npos){
+         continue;
+       }
+       std::string key = pair.substr(0, eq);
+       std::string value = pair.substr(eq + 1);
+       if(key == "checksum_log"){
+         options.checksumLog = unescapeTaskField(value);
+       }else if(key == "compress"){
+         options.compress = value == "1";
+       }else if(key == "cipher"){
+         cipherFromString(value, options.cipher);
+       }else if(key == "direct_io"){
+         options.directIO = value == "1";
+       }else if(key == "skip_holes"){
+         options.skipHoles = value == "1";
+       }else if(key == "root"){
+         options.root = std::stoul(value);
+       }else if(key == "expect_crc"){
+         options.expectedCrc = static_cast<uint32_t>(std::stoul(value));
+       }else if(key == "expect_size"){
+         options.expectedSize = std::stoull(value);
+       }
+     }
+     return options;
+   }
+};
+
+#endif
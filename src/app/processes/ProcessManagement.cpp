@@ -1,66 +1,174 @@
 #include "ProcessManagement.hpp"
 #include<iostream>
 #include<cstring>
+#include<cerrno>
 #include<sys/wait.h>
 #include "../encryptDecrypt/Cryption.hpp"
+#include "BenchmarkLogger.hpp"
+#include "../FileHandling/BufferPool.hpp"
 #include <sys/mman.h>
 #include <atomic>
 #include <sys/fcntl.h>
 #include <semaphore.h>
+#include <signal.h>
+#include <poll.h>
 
-ProcessManagement::ProcessManagement(){
+namespace {
+    // Self-pipe written on every child exit and controller limit change, so
+    // a submission waiting for a free slot sleeps in poll() until either
+    int wakePipe[2] = {-1, -1};
+
+    void wake() {
+        int savedErrno = errno;
+        char byte = 1;
+        // Non-blocking: a full pipe already means "wake up"
+        ssize_t ignored = write(wakePipe[1], &byte, 1);
+        (void)ignored;
+        errno = savedErrno;
+    }
+
+    void onChildExit(int) {
+        wake();
+    }
+}
+
+ProcessManagement::ProcessManagement(int minWorkers, int maxWorkers)
+    : controller(minWorkers, maxWorkers, [this] {
+          size_t queued = sharedMem->size.load() + waitingSubmissions.load();
+          return ControllerSample{BenchmarkLogger::completed_bytes(), queued};
+      }) {
+    // Named semaphores outlive the process; drop counts left by an earlier run
+    sem_unlink("/items_semaphore");
+    sem_unlink("/empty_slots_semaphore");
+    sem_unlink("/queue_lock_semaphore");
     itemsSemaphore = sem_open("/items_semaphore", O_CREAT, 0666, 0);
     emptySlotsSemaphore = sem_open("/empty_slots_semaphore", O_CREAT, 0666, 1000);
+    queueSemaphore = sem_open("/queue_lock_semaphore", O_CREAT, 0666, 1);
     shmFd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     ftruncate(shmFd, sizeof(SharedMemory));
     sharedMem = static_cast<SharedMemory *>(mmap(nullptr, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0));
     sharedMem->front = 0;
     sharedMem->rear = 0;
     sharedMem->size.store(0);
+
+    if (pipe2(wakePipe, O_NONBLOCK | O_CLOEXEC) == 0) {
+        struct sigaction action{};
+        action.sa_handler = onChildExit;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        sigaction(SIGCHLD, &action, &previousChildAction);
+    }
+    controller.setOnChange([](int) { wake(); });
+    controller.start();
 }
 
 ProcessManagement::~ProcessManagement() {
+    controller.stop();
+    if (wakePipe[0] >= 0) {
+        sigaction(SIGCHLD, &previousChildAction, nullptr);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        wakePipe[0] = wakePipe[1] = -1;
+    }
     munmap(sharedMem, sizeof(SharedMemory));
     shm_unlink(SHM_NAME);
+    sem_close(itemsSemaphore);
+    sem_close(emptySlotsSemaphore);
+    sem_close(queueSemaphore);
+    sem_unlink("/items_semaphore");
+    sem_unlink("/empty_slots_semaphore");
+    sem_unlink("/queue_lock_semaphore");
 }
 
 bool ProcessManagement::SubmitToQueue(std::unique_ptr<Task>task){
+    std::string taskData = task->toString();
+    if (taskData.size() >= TASK_SLOT_SIZE) {
+        std::cerr << "Task too long for the shared queue: " << task->filePath << std::endl;
+        return false;
+    }
+    waitForWorkerSlot();
+
     sem_wait(emptySlotsSemaphore);
-    std::unique_lock<std::mutex> lock(queueLock);
+    sem_wait(queueSemaphore);
 
     if (sharedMem->size.load() >= 1000) {
+        sem_post(queueSemaphore);
+        sem_post(emptySlotsSemaphore);
         return false;
     }
-    strcpy(sharedMem->tasks[sharedMem->rear], task->toString().c_str());
+    strcpy(sharedMem->tasks[sharedMem->rear], taskData.c_str());
     sharedMem->rear = (sharedMem->rear + 1) % 1000;
     sharedMem->size.fetch_add(1);
-    lock.unlock();
+    sem_post(queueSemaphore);
     sem_post(itemsSemaphore);
 
     int pid = fork();
     if(pid<0){
         return false;
     }else if(pid == 0){
-        // std::cout<<"Entering the child process"<<std::endl;
-        executeTasks();
+        executeNextTask();
         exit(0);
-        // std::cout<<"Exiting the child process"<<std::endl;
     }
-    // else{
-    //     std::cout<<"Entering the parent process"<<std::endl;
-    // }
+    liveWorkers++;
     return true;
 }
 
 void ProcessManagement::executeTasks(){
+    while (liveWorkers > 0) {
+        reapWorkers(true);
+    }
+    controller.stop();
+}
+
+void ProcessManagement::executeNextTask(){
    sem_wait(itemsSemaphore);
-   std::unique_lock<std::mutex> lock(queueLock);
-   char taskstr[256];
+   sem_wait(queueSemaphore);
+   char taskstr[TASK_SLOT_SIZE];
    strcpy(taskstr, sharedMem->tasks[sharedMem->front]);
    sharedMem->front = (sharedMem->front + 1) % 1000;
    sharedMem->size.fetch_sub(1);
-   lock.unlock();
+   sem_post(queueSemaphore);
    sem_post(emptySlotsSemaphore);
 
    executeCryption(taskstr);
-}
\ No newline at end of file
+}
+
+void ProcessManagement::waitForWorkerSlot(){
+    // Sleep until a child exits or the controller raises the limit; both
+    // write to the wake pipe, so an exit between the reap and the poll
+    // still ends the wait
+    waitingSubmissions.fetch_add(1);
+    reapWorkers(false);
+    while (liveWorkers >= controller.activeLimit()) {
+        if (wakePipe[0] < 0) {
+            reapWorkers(true);
+            continue;
+        }
+        pollfd wakeUp{wakePipe[0], POLLIN, 0};
+        poll(&wakeUp, 1, -1);
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+        }
+        reapWorkers(false);
+    }
+    waitingSubmissions.fetch_sub(1);
+}
+
+int ProcessManagement::reapWorkers(bool block){
+    int reaped = 0;
+    int status;
+    while (liveWorkers > 0) {
+        pid_t pid = waitpid(-1, &status, (block && reaped == 0) ? 0 : WNOHANG);
+        if (pid < 0 && errno == ECHILD) {
+            liveWorkers = 0;
+        }
+        if (pid <= 0) {
+            break;
+        }
+        liveWorkers--;
+        reaped++;
+        // A worker killed mid-file never released its buffers
+        BufferPool::instance().reclaim(pid);
+    }
+    return reaped;
+}
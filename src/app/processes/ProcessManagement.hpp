@@ -2,27 +2,38 @@
 #define PROCESS_MANAGEMENT_HPP
 
 #include "Task.hpp"
+#include "../concurrency/ConcurrencyController.hpp"
 #include <queue>
 #include <memory>
 #include <atomic>
 #include <semaphore.h>
+#include <signal.h>
 #include <mutex>
 
 class ProcessManagement
 {
      sem_t* itemsSemaphore;
      sem_t* emptySlotsSemaphore;
+     sem_t* queueSemaphore;
 public:
-     ProcessManagement();
+     ProcessManagement(int minWorkers = 1, int maxWorkers = ConcurrencyController::defaultMaxWorkers());
      ~ProcessManagement();
      bool SubmitToQueue(std::unique_ptr<Task> task);
+     // Blocks until every forked worker has finished
      void executeTasks();
 
 private:
+     void executeNextTask();
+     void waitForWorkerSlot();
+     int reapWorkers(bool block);
+
+     // Room for the path plus serialized JobOptions
+     static const size_t TASK_SLOT_SIZE = 1024;
+
      struct SharedMemory
      {
           std::atomic<int> size;
-          char tasks[1000][256];
+          char tasks[1000][TASK_SLOT_SIZE];
           int front;
           int rear;
 
@@ -36,7 +47,11 @@ private:
      SharedMemory *sharedMem;
      int shmFd;
      const char *SHM_NAME = "/my_queue";
-     std::mutex queueLock;
+
+     struct sigaction previousChildAction{};
+     int liveWorkers = 0;
+     std::atomic<int> waitingSubmissions{0};
+     ConcurrencyController controller;
 };
 
-#endif
\ No newline at end of file
+#endif
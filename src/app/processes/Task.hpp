@@ -5,16 +5,37 @@
 #include<iostream>
 #include<sstream>
 #include "../FileHandling/IO.hpp"
+#include "../encryptDecrypt/JobOptions.hpp"
 
 enum class Action{
     ENCRYPT,
-    DECRYPT
+    DECRYPT,
+    VERIFY,
+    EXTRACT
 };
 
+inline const char *actionToString(Action action){
+    switch(action){
+      case Action::ENCRYPT: return "ENCRYPT";
+      case Action::DECRYPT: return "DECRYPT";
+      case Action::VERIFY: return "VERIFY";
+      case Action::EXTRACT: return "EXTRACT";
+    }
+    return "DECRYPT";
+}
+
+inline Action actionFromString(const std::string &actionStr){
+    if(actionStr == "ENCRYPT") return Action::ENCRYPT;
+    if(actionStr == "VERIFY") return Action::VERIFY;
+    if(actionStr == "EXTRACT") return Action::EXTRACT;
+    return Action::DECRYPT;
+}
+
 struct Task{
    std::string filePath;
    std::fstream f_stream;
    Action action;
+   JobOptions options;
 
    Task(std::fstream &&stream, Action act, std::string filePath)
     : filePath(filePath), f_stream(std::move(stream)), action(act) {}
@@ -22,21 +43,36 @@ struct Task{
 
    std::string toString(){
      std::ostringstream oss;
-     oss<<filePath<<","<<(action == Action::ENCRYPT? "ENCRYPT" : "DECRYPT");
+     oss<<escapeTaskField(filePath)<<","<<actionToString(action);
+     std::string opts = options.toString();
+     if(!opts.empty()){
+       oss<<","<<opts;
+     }
      return oss.str();
    }
 
-   static Task fromString(const std::string &taskData){
+   // Workers that do their own I/O pass openStream = false to skip the fstream open
+   static Task fromString(const std::string &taskData, bool openStream = true){
        std::istringstream iss(taskData);
        std::string filePath;
        std::string actionStr;
+       std::string optionsStr;
 
-       if(std::getline(iss, filePath, ',' ) && std::getline(iss, actionStr)){
-          Action action = (actionStr == "ENCRYPT") ? Action::ENCRYPT : Action::DECRYPT;
+       if(std::getline(iss, filePath, ',' ) && std::getline(iss, actionStr, ',')){
+          filePath = unescapeTaskField(filePath);
+          Action action = actionFromString(actionStr);
+          std::getline(iss, optionsStr);
+          if(!openStream){
+            Task task(std::fstream(), action, filePath);
+            task.options = JobOptions::fromString(optionsStr);
+            return task;
+          }
           IO io(filePath);
           std::fstream f_stream = std::move(io.getFileStream());
           if(f_stream.is_open()){
-            return Task(std::move(f_stream), action, filePath);
+            Task task(std::move(f_stream), action, filePath);
+            task.options = JobOptions::fromString(optionsStr);
+            return task;
           }else{
             throw std::runtime_error("Failed to open file: "+ filePath);
           }
@@ -0,0 +1,320 @@
+#include "ScalingStudy.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Any integer works as the shift key; the study only needs the
+    // encrypt/decrypt pair to round trip
+    const char STUDY_KEY[] = "7\n";
+
+    double timevalSeconds(const timeval &tv) {
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    // Value after "<label>: " in the executor's report, or -1
+    double reportValue(const std::string &output, const std::string &label) {
+        size_t at = output.find("\n" + label + ": ");
+        if (at == std::string::npos) {
+            return -1;
+        }
+        return std::strtod(output.c_str() + at + label.size() + 3, nullptr);
+    }
+
+    // xorshift64*, so a corpus is identical across runs and machines
+    struct CorpusRandom
+    {
+        uint64_t state;
+
+        uint64_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ULL;
+        }
+    };
+
+    // FNV-1a of the shape name, for the seed: std::hash differs between
+    // standard libraries
+    uint64_t corpusSeed(const std::string &name) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+const std::vector<ScalingStudy::CorpusShape> &ScalingStudy::shapes() {
+    // Sizes are log-uniform between the bounds
+    static const std::vector<CorpusShape> known = {
+        {"small", 4000, 512, 16 * 1024},
+        {"mixed", 400, 1024, 2 * 1024 * 1024},
+        {"large", 8, 16 * 1024 * 1024, 32 * 1024 * 1024},
+    };
+    return known;
+}
+
+ScalingStudy::ScalingStudy(Options studyOptions) : options(std::move(studyOptions)) {}
+
+bool ScalingStudy::prepareCorpus(const CorpusShape &shape, std::string &directory, size_t &bytes) {
+    directory = (fs::path(options.scratch) / ("corpus-" + shape.name)).string();
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+    CorpusRandom random{0x9E3779B97F4A7C15ULL ^ corpusSeed(shape.name)};
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string contents;
+    bytes = 0;
+    for (size_t i = 0; i < shape.files; i++) {
+        // 100 files per directory, like a real tree rather than one flat listing
+        fs::path sub = fs::path(directory) / ("d" + std::to_string(i / 100));
+        if (i % 100 == 0 && !fs::create_directories(sub, ec) && ec) {
+            std::cerr << "Unable to create " << sub << ": " << ec.message() << std::endl;
+            return false;
+        }
+        double span = std::log(static_cast<double>(shape.maxBytes) / shape.minBytes);
+        double fraction = (random.next() >> 11) * (1.0 / (1ULL << 53));
+        size_t size = static_cast<size_t>(shape.minBytes * std::exp(span * fraction));
+        contents.resize(size);
+        for (size_t j = 0; j < size; j++) {
+            contents[j] = alphabet[random.next() % (sizeof(alphabet) - 1)];
+        }
+        std::ofstream out(sub / ("f" + std::to_string(i) + ".txt"), std::ios::binary);
+        out.write(contents.data(), contents.size());
+        if (!out) {
+            std::cerr << "Unable to write corpus " << shape.name << std::endl;
+            return false;
+        }
+        bytes += size;
+    }
+    return true;
+}
+
+bool ScalingStudy::runExecutor(const std::string &backend, const std::string &directory, size_t blockKB,
+                               int workers, const std::string &action, Point &point, std::string &output) {
+    std::string binary = (fs::path(options.binaryDir) / (backend == "thread" ? "encrypt_decrypt_mt" : "encrypt_decrypt")).string();
+    std::string workerCount = std::to_string(workers);
+    std::string blockSize = std::to_string(blockKB);
+    // Pinning min and max keeps the adaptive controller at exactly N workers
+    std::vector<const char *> args = {binary.c_str(), "--min-workers", workerCount.c_str(), "--max-workers",
+                                      workerCount.c_str(), "--block-size", blockSize.c_str(), action.c_str(),
+                                      directory.c_str(), nullptr};
+
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) {
+        output = std::string("pipe: ") + strerror(errno);
+        return false;
+    }
+    auto started = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        output = std::string("fork: ") + strerror(errno);
+        return false;
+    }
+    if (pid == 0) {
+        // The executors read the key from ./.env
+        int devNull = open("/dev/null", O_RDONLY);
+        dup2(devNull, STDIN_FILENO);
+        dup2(pipeFds[1], STDOUT_FILENO);
+        dup2(pipeFds[1], STDERR_FILENO);
+        close(pipeFds[0]);
+        if (chdir(options.scratch.c_str()) != 0) {
+            _exit(126);
+        }
+        execv(args[0], const_cast<char *const *>(args.data()));
+        _exit(127);
+    }
+    close(pipeFds[1]);
+    output.clear();
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(pipeFds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, n);
+    }
+    close(pipeFds[0]);
+
+    // wait4() rather than getrusage(RUSAGE_CHILDREN): the figures are for
+    // this run alone, and ru_maxrss is not a running total
+    int status = 0;
+    struct rusage usage{};
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        output += std::string("\nwait4: ") + strerror(errno);
+        return false;
+    }
+    point.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    point.userSeconds = timevalSeconds(usage.ru_utime);
+    point.systemSeconds = timevalSeconds(usage.ru_stime);
+    point.voluntarySwitches = usage.ru_nvcsw;
+    point.involuntarySwitches = usage.ru_nivcsw;
+    point.maxRssKB = usage.ru_maxrss;
+
+    point.seconds = reportValue(output, "Total Duration");
+    double completed = reportValue(output, "Crypto Operations Completed");
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || point.seconds < 0 ||
+        completed != static_cast<double>(point.files)) {
+        return false;
+    }
+    return true;
+}
+
+bool ScalingStudy::run() {
+    std::error_code ec;
+    fs::create_directories(options.scratch, ec);
+    {
+        std::ofstream env(fs::path(options.scratch) / ".env");
+        env << STUDY_KEY;
+        if (!env) {
+            std::cerr << "Unable to write " << options.scratch << "/.env" << std::endl;
+            return false;
+        }
+    }
+    for (const std::string &backend : options.backends) {
+        std::string binary = (backend == "thread") ? "encrypt_decrypt_mt" : "encrypt_decrypt";
+        if (access((fs::path(options.binaryDir) / binary).c_str(), X_OK) != 0) {
+            std::cerr << "No executable " << binary << " in " << options.binaryDir << std::endl;
+            return false;
+        }
+    }
+
+    for (const std::string &corpusName : options.corpora) {
+        auto shape = std::find_if(shapes().begin(), shapes().end(),
+                                  [&corpusName](const CorpusShape &s) { return s.name == corpusName; });
+        std::string directory;
+        size_t bytes = 0;
+        if (!prepareCorpus(*shape, directory, bytes)) {
+            return false;
+        }
+        std::cout << "Corpus " << shape->name << ": " << shape->files << " files, " << std::fixed
+                  << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB in " << directory << std::endl;
+
+        // One untimed round trip so the first point does not pay for a cold page cache
+        Point warmup;
+        warmup.files = shape->files;
+        std::string output;
+        for (const char *action : {"encrypt", "decrypt"}) {
+            if (!runExecutor(options.backends.front(), directory, options.blockSizesKB.front(),
+                             options.workers.back(), action, warmup, output)) {
+                std::cerr << "Warm-up " << action << " failed:\n" << output << std::endl;
+                return false;
+            }
+        }
+
+        for (const std::string &backend : options.backends) {
+            for (size_t blockKB : options.blockSizesKB) {
+                for (int workers : options.workers) {
+                    for (const char *action : {"encrypt", "decrypt"}) {
+                        // Median by duration over the repeats; its rusage comes with it
+                        std::vector<Point> repeats;
+                        for (int r = 0; r < options.repeat; r++) {
+                            Point point;
+                            point.backend = backend;
+                            point.corpus = shape->name;
+                            point.action = action;
+                            point.blockKB = blockKB;
+                            point.workers = workers;
+                            point.files = shape->files;
+                            point.bytes = bytes;
+                            point.ok = runExecutor(backend, directory, blockKB, workers, action, point, output);
+                            if (!point.ok) {
+                                std::cerr << backend << " " << action << " with " << workers << " workers failed:\n"
+                                          << output << std::endl;
+                                // Left half-transformed, the corpus cannot feed further points
+                                return false;
+                            }
+                            repeats.push_back(point);
+                            // Undo the transform between repeats so each one sees the same input
+                            if (r + 1 < options.repeat) {
+                                Point undo;
+                                undo.files = shape->files;
+                                const char *reverse = std::string(action) == "encrypt" ? "decrypt" : "encrypt";
+                                if (!runExecutor(backend, directory, blockKB, workers, reverse, undo, output)) {
+                                    std::cerr << "Restoring corpus " << shape->name << " failed:\n" << output << std::endl;
+                                    return false;
+                                }
+                            }
+                        }
+                        std::sort(repeats.begin(), repeats.end(),
+                                  [](const Point &a, const Point &b) { return a.seconds < b.seconds; });
+                        const Point &median = repeats[repeats.size() / 2];
+                        results.push_back(median);
+                        std::cout << "  " << std::left << std::setw(8) << backend << std::setw(6) << shape->name
+                                  << std::right << std::setw(6) << blockKB << " KB " << std::setw(4) << workers
+                                  << " workers " << std::left << std::setw(8) << action << std::right << std::fixed
+                                  << std::setprecision(2) << std::setw(9) << median.mbPerSecond() << " MB/s" << std::endl;
+                    }
+                }
+            }
+        }
+        fs::remove_all(directory, ec);
+    }
+    computeScaling();
+    return true;
+}
+
+void ScalingStudy::computeScaling() {
+    // Baseline: fewest workers among points sharing everything else
+    std::map<std::tuple<std::string, std::string, size_t, std::string>, const Point *> baselines;
+    for (const Point &point : results) {
+        auto key = std::make_tuple(point.backend, point.corpus, point.blockKB, point.action);
+        auto it = baselines.find(key);
+        if (it == baselines.end() || point.workers < it->second->workers) {
+            baselines[key] = &point;
+        }
+    }
+    for (Point &point : results) {
+        const Point *baseline = baselines[std::make_tuple(point.backend, point.corpus, point.blockKB, point.action)];
+        if (baseline->mbPerSecond() > 0) {
+            point.speedup = point.mbPerSecond() / baseline->mbPerSecond();
+            point.efficiency = point.speedup * baseline->workers / point.workers;
+        }
+    }
+}
+
+void ScalingStudy::printTable() const {
+    std::cout << "\n================================" << std::endl;
+    std::cout << "  SCALING STUDY" << std::endl;
+    std::cout << "================================" << std::endl;
+    std::cout << std::left << std::setw(8) << "backend" << std::setw(7) << "corpus" << std::setw(8) << "action"
+              << std::right << std::setw(7) << "blockKB" << std::setw(8) << "workers" << std::setw(10) << "MB/s"
+              << std::setw(9) << "speedup" << std::setw(7) << "eff" << std::setw(7) << "CPU%" << std::setw(10)
+              << "vol csw" << std::setw(10) << "invol csw" << std::setw(10) << "maxRSS KB" << std::endl;
+    for (const Point &point : results) {
+        std::cout << std::left << std::setw(8) << point.backend << std::setw(7) << point.corpus << std::setw(8)
+                  << point.action << std::right << std::setw(7) << point.blockKB << std::setw(8) << point.workers
+                  << std::fixed << std::setprecision(2) << std::setw(10) << point.mbPerSecond() << std::setw(9)
+                  << point.speedup << std::setw(7) << point.efficiency << std::setprecision(0) << std::setw(7)
+                  << point.cpuPercent() << std::setw(10) << point.voluntarySwitches << std::setw(10)
+                  << point.involuntarySwitches << std::setw(10) << point.maxRssKB << std::endl;
+    }
+}
+
+bool ScalingStudy::writeCsv(const std::string &path) const {
+    std::ofstream out(path);
+    out << "backend,corpus,action,block_kb,workers,files,bytes,seconds,mb_per_sec,speedup,efficiency,"
+           "wall_seconds,user_seconds,system_seconds,cpu_percent,voluntary_csw,involuntary_csw,max_rss_kb\n";
+    for (const Point &point : results) {
+        out << point.backend << ',' << point.corpus << ',' << point.action << ',' << point.blockKB << ','
+            << point.workers << ',' << point.files << ',' << point.bytes << ',' << std::fixed << std::setprecision(6)
+            << point.seconds << ',' << std::setprecision(3) << point.mbPerSecond() << ',' << point.speedup << ','
+            << point.efficiency << ',' << std::setprecision(6) << point.wallSeconds << ',' << point.userSeconds << ','
+            << point.systemSeconds << ',' << std::setprecision(1) << point.cpuPercent() << ','
+            << point.voluntarySwitches << ',' << point.involuntarySwitches << ',' << point.maxRssKB << '\n';
+    }
+    return static_cast<bool>(out);
+}
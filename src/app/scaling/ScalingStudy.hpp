@@ -0,0 +1,88 @@
+#ifndef SCALING_STUDY_HPP
+#define SCALING_STUDY_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Runs the real executors (encrypt_decrypt and encrypt_decrypt_mt) over a
+// grid of worker counts, block sizes, backends and corpus shapes. Every
+// point is an encrypt run followed by a decrypt run of the same corpus,
+// so the corpus is back in its original state for the next point.
+//
+// Per run the study keeps the executor's own Total Duration and the
+// child's rusage from wait4() (user/system time, context switches, peak
+// RSS; forked workers are included because the executor reaps them).
+// Speedup and efficiency are relative to the smallest worker count of the
+// same backend/corpus/block size/action.
+class ScalingStudy
+{
+public:
+     struct CorpusShape
+     {
+          std::string name;
+          size_t files;
+          size_t minBytes;
+          size_t maxBytes;
+     };
+
+     struct Options
+     {
+          std::vector<int> workers;
+          std::vector<size_t> blockSizesKB = {1024};
+          std::vector<std::string> backends = {"process", "thread"};
+          std::vector<std::string> corpora = {"small", "mixed"};
+          int repeat = 3;
+          std::string scratch;   // corpora and the executors' .env live here
+          std::string binaryDir; // where encrypt_decrypt(_mt) are found
+          std::string csvPath;
+     };
+
+     struct Point
+     {
+          std::string backend;
+          std::string corpus;
+          std::string action;
+          size_t blockKB = 0;
+          int workers = 0;
+          size_t files = 0;
+          size_t bytes = 0;
+          bool ok = false;
+          double seconds = 0;     // executor's Total Duration
+          double wallSeconds = 0; // exec to exit, for the CPU figure
+          double userSeconds = 0;
+          double systemSeconds = 0;
+          long voluntarySwitches = 0;
+          long involuntarySwitches = 0;
+          long maxRssKB = 0;
+          double speedup = 0;
+          double efficiency = 0;
+
+          double mbPerSecond() const { return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0; }
+          // Cores kept busy on average, as time(1) reports it
+          double cpuPercent() const { return wallSeconds > 0 ? 100.0 * (userSeconds + systemSeconds) / wallSeconds : 0; }
+     };
+
+     static const std::vector<CorpusShape> &shapes();
+
+     explicit ScalingStudy(Options options);
+
+     // Runs the whole grid, printing one line per point as it goes.
+     // Returns false if setup failed or any point failed.
+     bool run();
+
+     const std::vector<Point> &points() const { return results; }
+     void printTable() const;
+     bool writeCsv(const std::string &path) const;
+
+private:
+     bool prepareCorpus(const CorpusShape &shape, std::string &directory, size_t &bytes);
+     bool runExecutor(const std::string &backend, const std::string &directory, size_t blockKB,
+                      int workers, const std::string &action, Point &point, std::string &output);
+     void computeScaling();
+
+     Options options;
+     std::vector<Point> results;
+};
+
+#endif
@@ -1,58 +1,156 @@
 #include "ThreadManagement.hpp"
 #include<iostream>
-#include<cstring>
-#include<sys/wait.h>
+#include<filesystem>
 #include "../encryptDecrypt/Cryption.hpp"
-#include <sys/mman.h>
-#include <atomic>
-#include <sys/fcntl.h>
-#include <semaphore.h>
-#include<thread>
-
-ThreadManagement::ThreadManagement(){
-    itemsSemaphore = sem_open("/items_semaphore", O_CREAT, 0666, 0);
-    emptySlotsSemaphore = sem_open("/empty_slots_semaphore", O_CREAT, 0666, 1000);
-    shmFd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-    ftruncate(shmFd, sizeof(SharedMemory));
-    sharedMem = static_cast<SharedMemory *>(mmap(nullptr, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0));
-    sharedMem->front = 0;
-    sharedMem->rear = 0;
-    sharedMem->size.store(0);
+#include "../FileHandling/BufferPool.hpp"
+#include "../FileHandling/DiskLayout.hpp"
+#include "BenchmarkLogger2.hpp"
+
+ThreadManagement::ThreadManagement(int minWorkers, int maxWorkers)
+    : controller(minWorkers, maxWorkers, [this] {
+          std::lock_guard<std::mutex> lock(queueLock);
+          return ControllerSample{BenchmarkLogger2::completed_bytes(), queuedTasks};
+      }) {
+    controller.setOnChange([this](int) {
+        std::lock_guard<std::mutex> lock(queueLock);
+        workAvailable.notify_all();
+    });
+
+    // Spawn the whole pool up front; the controller decides how many of them may run
+    for (int i = 0; i < controller.maxWorkers(); i++) {
+        workers.emplace_back(&ThreadManagement::workerLoop, this, i);
+    }
+    controller.start();
 }
 
 ThreadManagement::~ThreadManagement() {
-    munmap(sharedMem, sizeof(SharedMemory));
-    shm_unlink(SHM_NAME);
+    shutdown();
 }
 
 bool ThreadManagement::SubmitToQueue(std::unique_ptr<Task>task){
-    sem_wait(emptySlotsSemaphore);
-    std::unique_lock<std::mutex> lock(queueLock);
+    return SubmitToQueue(std::move(task), 0, nullptr);
+}
+
+bool ThreadManagement::SubmitToQueue(std::unique_ptr<Task> task, int jobId, CompletionCallback onDone, unsigned weight){
+    // Archive members are not files yet; they are charged the fixed cost only
+    std::error_code ec;
+    uintmax_t bytes = std::filesystem::file_size(task->filePath, ec);
+    size_t cost = FairShare::taskCost(ec ? 0 : static_cast<size_t>(bytes));
 
-    if (sharedMem->size.load() >= 1000) {
+    std::unique_lock<std::mutex> lock(queueLock);
+    slotAvailable.wait(lock, [this, jobId] { return jobQueues[jobId].size() < QUEUE_CAPACITY || stopping; });
+    if (stopping) {
         return false;
     }
-    strcpy(sharedMem->tasks[sharedMem->rear], task->toString().c_str());
-    sharedMem->rear = (sharedMem->rear + 1) % 1000;
-    sharedMem->size.fetch_add(1);
+    fairShare.setWeight(jobId, weight);
+    jobQueues[jobId].push_back(QueuedTask{task->toString(), std::move(onDone), cost});
+    queuedTasks++;
     lock.unlock();
-    sem_post(itemsSemaphore);
-    
-    std::thread thread_1(&ThreadManagement::executeTasks, this);
-    thread_1.detach();
+    workAvailable.notify_all();
 
     return true;
 }
 
 void ThreadManagement::executeTasks(){
-   sem_wait(itemsSemaphore);
-   std::unique_lock<std::mutex> lock(queueLock);
-   char taskstr[256];
-   strcpy(taskstr, sharedMem->tasks[sharedMem->front]);
-   sharedMem->front = (sharedMem->front + 1) % 1000;
-   sharedMem->size.fetch_sub(1);
-   lock.unlock();
-   sem_post(emptySlotsSemaphore);
-
-   executeCryption(taskstr);
-}
\ No newline at end of file
+    {
+        std::unique_lock<std::mutex> lock(queueLock);
+        drained.wait(lock, [this] { return queuedTasks == 0 && inFlight == 0; });
+    }
+    shutdown();
+}
+
+bool ThreadManagement::popNextTask(QueuedTask &out){
+    // Weighted fair queueing: the job with the smallest start tag goes next.
+    // Scanning from the job after the one served last breaks ties round-robin.
+    auto best = jobQueues.end();
+    auto it = jobQueues.upper_bound(lastServedJob);
+    for (size_t i = 0; i < jobQueues.size(); i++, it++) {
+        if (it == jobQueues.end()) {
+            it = jobQueues.begin();
+        }
+        if (!it->second.empty() &&
+            (best == jobQueues.end() || fairShare.startTag(it->first) < fairShare.startTag(best->first))) {
+            best = it;
+        }
+    }
+    if (best == jobQueues.end()) {
+        return false;
+    }
+    out = std::move(best->second.front());
+    best->second.pop_front();
+    fairShare.charge(best->first, out.cost);
+    lastServedJob = best->first;
+    queuedTasks--;
+    if (best->second.empty()) {
+        fairShare.release(best->first);
+        jobQueues.erase(best);
+    }
+    return true;
+}
+
+void ThreadManagement::collectReadahead(int jobId, std::vector<std::string> &paths){
+    auto it = jobQueues.find(jobId);
+    if (readaheadFiles <= 0 || it == jobQueues.end()) {
+        return;
+    }
+    // Only files that just entered the window; earlier ones were advised already
+    int window = 0;
+    for (auto &queued : it->second) {
+        if (window++ >= readaheadFiles) {
+            break;
+        }
+        if (!queued.advised) {
+            queued.advised = true;
+            paths.push_back(unescapeTaskField(queued.taskData.substr(0, queued.taskData.find(','))));
+        }
+    }
+}
+
+void ThreadManagement::workerLoop(int workerId){
+    while (true) {
+        std::unique_lock<std::mutex> lock(queueLock);
+        workAvailable.wait(lock, [this, workerId] {
+            return stopping || (queuedTasks > 0 && workerId < controller.activeLimit());
+        });
+        if (stopping) {
+            return;
+        }
+        QueuedTask next;
+        popNextTask(next);
+        std::vector<std::string> upcoming;
+        collectReadahead(lastServedJob, upcoming);
+        inFlight++;
+        lock.unlock();
+        slotAvailable.notify_all();
+
+        for (const auto &path : upcoming) {
+            DiskLayout::willNeed(path, BufferPool::instance().blockSize() * DiskLayout::READAHEAD_BLOCKS);
+        }
+
+        int result = executeCryption(next.taskData);
+        if (next.onDone) {
+            next.onDone(result);
+        }
+
+        lock.lock();
+        inFlight--;
+        if (queuedTasks == 0 && inFlight == 0) {
+            drained.notify_all();
+        }
+    }
+}
+
+void ThreadManagement::shutdown(){
+    controller.stop();
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    slotAvailable.notify_all();
+    for (auto &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
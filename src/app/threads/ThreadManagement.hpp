@@ -2,41 +2,68 @@
 #define THREAD_MANAGEMENT_HPP
 
 #include "Task.hpp"
+#include "../concurrency/ConcurrencyController.hpp"
+#include "../concurrency/FairShare.hpp"
 #include <queue>
+#include <deque>
+#include <map>
 #include <memory>
 #include <atomic>
-#include <semaphore.h>
+#include <functional>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 
 class ThreadManagement
 {
-     sem_t* itemsSemaphore;
-     sem_t* emptySlotsSemaphore;
 public:
-     ThreadManagement();
+     // Receives the executeCryption() result of a finished task
+     using CompletionCallback = std::function<void(int)>;
+
+     ThreadManagement(int minWorkers = 1, int maxWorkers = ConcurrencyController::defaultMaxWorkers());
      ~ThreadManagement();
      bool SubmitToQueue(std::unique_ptr<Task> task);
+     // Tasks from different jobs (input roots, daemon clients) share the
+     // workers by weighted fair queueing on their bytes, so a big background
+     // job cannot starve an urgent one; each job gets its own 1000-slot queue
+     bool SubmitToQueue(std::unique_ptr<Task> task, int jobId, CompletionCallback onDone, unsigned weight = 1);
+     // Blocks until every submitted task has run, then stops the workers
      void executeTasks();
+     // Each dequeue issues WILLNEED readahead for up to this many of the
+     // job's next queued files (0 = off)
+     void setReadahead(int files) { readaheadFiles = files; }
 
 private:
-     struct SharedMemory
+     struct QueuedTask
      {
-          std::atomic<int> size;
-          char tasks[1000][256];
-          int front;
-          int rear;
-
-          void printSharedMemory()
-          {
-               std::cout << size << std::endl;
-               std::cout << front << std::endl;
-               std::cout << rear << std::endl;
-          }
+          std::string taskData;
+          CompletionCallback onDone;
+          size_t cost = 0;
+          bool advised = false;
      };
-     SharedMemory *sharedMem;
-     int shmFd;
-     const char *SHM_NAME = "/my_queue";
+
+     void workerLoop(int workerId);
+     void shutdown();
+     bool popNextTask(QueuedTask &out);
+     void collectReadahead(int jobId, std::vector<std::string> &paths);
+
+     static const size_t QUEUE_CAPACITY = 1000;
+
+     std::map<int, std::deque<QueuedTask>> jobQueues;
+     FairShare fairShare;
+     int lastServedJob = -1;
+     int readaheadFiles = 0;
+     size_t queuedTasks = 0;
      std::mutex queueLock;
+     std::condition_variable workAvailable;
+     std::condition_variable slotAvailable;
+     std::condition_variable drained;
+     int inFlight = 0;
+     bool stopping = false;
+
+     ConcurrencyController controller;
+     std::vector<std::thread> workers;
 };
 
-#endif
\ No newline at end of file
+#endif